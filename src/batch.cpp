@@ -0,0 +1,269 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#include "batch.h"
+#include "decoder.h"
+#include "encoder.h"
+#include "render.h"
+#include "threadpool.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSet>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+    // Decoded audio held in memory, and how many decodes are running.
+    // New decodes wait until both are below their limits.
+    class MemoryBudget
+    {
+    public:
+        MemoryBudget(const std::size_t cap, const int maxDecodes) : m_cap{cap}, m_maxDecodes{maxDecodes} {}
+
+        // never waits while nothing is held, so a single file bigger than the cap still gets through
+        void startDecode()
+        {
+            std::unique_lock lock{m_mutex};
+            m_changed.wait(lock, [this]() { return m_used < m_cap && m_decodes < m_maxDecodes; });
+            ++m_decodes;
+        }
+
+        void finishDecode()
+        {
+            {
+                std::lock_guard lock{m_mutex};
+                --m_decodes;
+            }
+            m_changed.notify_all();
+        }
+
+        void add(const std::size_t bytes)
+        {
+            std::lock_guard lock{m_mutex};
+            m_used += bytes;
+        }
+
+        void release(const std::size_t bytes)
+        {
+            {
+                std::lock_guard lock{m_mutex};
+                m_used -= bytes;
+            }
+            m_changed.notify_all();
+        }
+
+    private:
+        std::mutex m_mutex{};
+        std::condition_variable m_changed{};
+        const std::size_t m_cap;
+        const int m_maxDecodes;
+        std::size_t m_used{0};
+        int m_decodes{0};
+    };
+
+    // <output dir>/<name>_<speed>x.<extension> for every speed, or <name>_<speed>x_<n>.<extension> if an earlier
+    // output of this batch already has that name (the same name in another directory, or the same speed twice).
+    // taken holds the names used so far, lower case so case-insensitive file systems can't collide either.
+    QStringList outputPaths(const QString& source, const Batch::Settings& settings, QSet<QString>& taken)
+    {
+        const QFileInfo info{source};
+        const QDir dir{settings.outputDir};
+
+        QStringList paths{};
+        for (const float speed : settings.speeds)
+        {
+            const QString name{QString("%1_%2x").arg(info.completeBaseName()).arg(speed)};
+            const QString wanted{dir.filePath(QString("%1.%2").arg(name).arg(settings.extension))};
+            QString path{wanted};
+            for (int n{2}; taken.contains(path.toLower()); ++n)
+            {
+                path = dir.filePath(QString("%1_%2.%3").arg(name).arg(n).arg(settings.extension));
+            }
+
+            if (path != wanted)
+            {
+                std::fprintf(
+                    stderr,
+                    "%s is already an output, writing %s to %s\n",
+                    qPrintable(wanted),
+                    qPrintable(source),
+                    qPrintable(path));
+            }
+            taken.insert(path.toLower());
+            paths.append(path);
+        }
+        return paths;
+    }
+} // namespace
+
+QStringList Batch::expand(const QStringList& patterns)
+{
+    QStringList files{};
+    const auto add{[&](const QString& file)
+    {
+        if (!files.contains(file))
+        {
+            files.append(file);
+        }
+    }};
+
+    for (const QString& pattern : patterns)
+    {
+        const QFileInfo info{pattern};
+        if (info.isDir())
+        {
+            // every file directly inside it
+            for (const QFileInfo& entry : QDir{pattern}.entryInfoList(QDir::Files, QDir::Name))
+            {
+                add(entry.absoluteFilePath());
+            }
+        }
+        else if (info.fileName().contains('*') || info.fileName().contains('?'))
+        {
+            for (const QFileInfo& entry : QDir{info.path()}.entryInfoList({info.fileName()}, QDir::Files, QDir::Name))
+            {
+                add(entry.absoluteFilePath());
+            }
+        }
+        else if (info.isFile())
+        {
+            add(info.absoluteFilePath());
+        }
+        else
+        {
+            std::fprintf(stderr, "no such file: %s\n", qPrintable(pattern));
+        }
+    }
+    return files;
+}
+
+Batch::Result Batch::run(const Settings& settings)
+{
+    const auto start{std::chrono::steady_clock::now()};
+
+    Result result{};
+    std::mutex resultMutex{};
+    std::atomic<bool> running{true};
+
+    ThreadPool pool{settings.threads};
+    MemoryBudget budget{settings.memoryCap, pool.threads()};
+
+    // named up front in input order, so which output gets a suffix doesn't depend on which render finishes first
+    QSet<QString> taken{};
+    QList<QStringList> outputs{};
+    for (const QString& file : settings.files)
+    {
+        outputs.push_back(outputPaths(file, settings, taken));
+    }
+
+    for (qsizetype f{0}; f < settings.files.size(); ++f)
+    {
+        const QString& file{settings.files[f]};
+        budget.startDecode();
+        pool.submit(
+            [&, file, paths = outputs[f]]()
+            {
+                std::shared_ptr<SampleStore> store{};
+                int sampleRate{0};
+                std::size_t held{0};
+
+                const auto started{[&](const std::shared_ptr<SampleStore>& newStore, const Decoder::Stream& stream)
+                {
+                    store = newStore;
+                    sampleRate = stream.sampleRate;
+                }};
+                // counted while decoding, not only once it's done
+                const auto decoded{[&]()
+                {
+                    const std::size_t usage{store->memoryUsage()};
+                    budget.add(usage - held);
+                    held = usage;
+                }};
+
+                bool complete{false};
+                Decoder::decode(
+                    file,
+                    SampleStore::Format::Float,
+                    0,
+                    SampleStore::s_maxChannels,
+                    running,
+                    started,
+                    decoded,
+                    &complete);
+                budget.finishDecode();
+
+                if (!store || !complete || store->frames() == 0)
+                {
+                    std::lock_guard lock{resultMutex};
+                    std::fprintf(stderr, "failed to decode %s\n", qPrintable(file));
+                    ++result.failed;
+                    budget.release(held);
+                    return;
+                }
+                store->finish();
+
+                {
+                    std::lock_guard lock{resultMutex};
+                    ++result.sources;
+                    result.sourceSeconds += static_cast<double>(store->frames()) / sampleRate;
+                }
+
+                // every speed renders from the same decoded store, the last one to finish frees it
+                const auto remaining{std::make_shared<std::atomic<std::size_t>>(settings.speeds.size())};
+                for (std::size_t s{0}; s < settings.speeds.size(); ++s)
+                {
+                    pool.submit(
+                        [&, store, sampleRate, speed = settings.speeds[s], path = paths[s], remaining, bytes = held]()
+                        {
+                            // one segment at a time, the pool already keeps every core busy
+                            Render::Settings render{};
+                            render.speed = speed;
+                            render.threads = 1;
+
+                            AudioEncoder encoder{};
+                            const bool written{
+                                encoder.open(path, sampleRate, store->channels()) &&
+                                Render::stretch(
+                                    *store,
+                                    sampleRate,
+                                    render,
+                                    [&](const float* audio, const std::size_t frames)
+                                    { return encoder.write(audio, frames); },
+                                    running) &&
+                                encoder.close()};
+
+                            {
+                                std::lock_guard lock{resultMutex};
+                                if (written)
+                                {
+                                    ++result.outputs;
+                                    result.outputSeconds +=
+                                        static_cast<double>(Render::outputFrames(store->frames(), speed)) / sampleRate;
+                                    std::printf("wrote %s\n", qPrintable(path));
+                                }
+                                else
+                                {
+                                    ++result.failed;
+                                    std::fprintf(stderr, "failed to write %s\n", qPrintable(path));
+                                }
+                            }
+
+                            if (remaining->fetch_sub(1) == 1)
+                            {
+                                budget.release(bytes);
+                            }
+                        });
+                }
+            });
+    }
+
+    pool.wait();
+    result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
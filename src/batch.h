@@ -0,0 +1,43 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_BATCH_H
+#define SPEEDSHIFTER_BATCH_H
+
+#include <QString>
+#include <QStringList>
+
+#include <cstddef>
+#include <vector>
+
+// Renders many files at several speeds on one thread pool.
+// Every source is decoded once and shared by the renders for all of its speeds, new decodes only start
+// while the decoded audio held in memory stays below a cap.
+namespace Batch
+{
+    struct Settings
+    {
+        QStringList files{};
+        std::vector<float> speeds{};
+        QString outputDir{};
+        QString extension{"flac"}; // wav or flac
+        std::size_t memoryCap{std::size_t{2} * 1024 * 1024 * 1024};
+        int threads{0}; // 0 uses every core
+    };
+
+    struct Result
+    {
+        int sources{0};
+        int outputs{0};
+        int failed{0};
+        double sourceSeconds{0.0}; // audio decoded
+        double outputSeconds{0.0}; // audio written
+        double wallSeconds{0.0};
+    };
+
+    // files matching any of patterns (paths with * and ? in the file name), in order, without duplicates
+    [[nodiscard]] QStringList expand(const QStringList& patterns);
+
+    Result run(const Settings& settings);
+} // namespace Batch
+
+#endif // SPEEDSHIFTER_BATCH_H
@@ -0,0 +1,336 @@
+// Created by Jens Kromdijk 17/10/2026
+
+// End to end benchmarks of the load and playback paths on generated signals (sweeps, noise, silence):
+// decode, decode with resampling, peak building, per-block stretching at MIN_SPEED..MAX_SPEED and
+// ring buffer round trips. Results go to stdout as JSON so runs can be compared across commits,
+// a readable summary goes to stderr.
+// usage: speedshifter-bench [seconds of audio per signal]
+
+#include "decoder.h"
+#include "encoder.h"
+#include "kernels.h"
+#include "peakpyramid.h"
+#include "samplestore.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QTemporaryDir>
+
+#include <miniaudio.h>
+#include <signalsmith-stretch.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // what the player processes per block by default
+    constexpr std::size_t s_blockFrames{1024};
+    // MIN_SPEED to MAX_SPEED (see player.h)
+    constexpr std::array<float, 7> s_speeds{0.2f, 0.5f, 0.75f, 1.0f, 1.25f, 1.5f, 2.0f};
+    constexpr std::array<const char*, 3> s_signals{"sweep", "noise", "silence"};
+    constexpr double s_pi{3.14159265358979323846};
+
+    struct Config
+    {
+        int sampleRate;
+        int channels;
+    };
+    constexpr std::array<Config, 3> s_configs{{{44100, 2}, {48000, 1}, {96000, 2}}};
+
+    struct Result
+    {
+        std::string benchmark;
+        std::string signal;
+        int sampleRate;
+        int channels;
+        float speed; // 0 if it doesn't apply
+        std::string unit;
+        double value;
+    };
+
+    double secondsOf(const std::function<void()>& run)
+    {
+        const auto start{std::chrono::steady_clock::now()};
+        run();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // interleaved test signal
+    std::vector<float> generate(
+        const std::string& signal,
+        const int sampleRate,
+        const int channels,
+        const double seconds)
+    {
+        const std::size_t frames{static_cast<std::size_t>(seconds * sampleRate)};
+        std::vector<float> audio(frames * channels, 0.0f);
+        std::mt19937 random{1234};
+        std::uniform_real_distribution<float> noise{-0.5f, 0.5f};
+
+        for (std::size_t f{0}; f < frames; ++f)
+        {
+            float sample{0.0f};
+            if (signal == "sweep")
+            {
+                // exponential 20 Hz .. 20 kHz
+                const double t{static_cast<double>(f) / sampleRate};
+                const double k{std::log(1000.0) / seconds};
+                sample = static_cast<float>(0.5 * std::sin(2.0 * s_pi * 20.0 * (std::exp(k * t) - 1.0) / k));
+            }
+            else if (signal == "noise")
+            {
+                sample = noise(random);
+            }
+            for (int c{0}; c < channels; ++c)
+            {
+                audio[f * channels + c] = sample;
+            }
+        }
+        return audio;
+    }
+
+    std::shared_ptr<SampleStore> makeStore(const std::vector<float>& audio, const int channels)
+    {
+        std::shared_ptr<SampleStore> store{SampleStore::create(SampleStore::Format::Float, channels)};
+        store->append(audio.data(), audio.size() / channels);
+        store->finish();
+        return store;
+    }
+
+    // decodes path, resampled to sampleRate (0 keeps it), returns x realtime
+    double decodeSpeed(const QString& path, const int sampleRate, const double seconds)
+    {
+        std::atomic<bool> running{true};
+        const double elapsed{secondsOf(
+            [&]()
+            {
+                Decoder::decode(
+                    path,
+                    SampleStore::Format::Float,
+                    sampleRate,
+                    SampleStore::s_maxChannels,
+                    running,
+                    nullptr,
+                    nullptr);
+            })};
+        return seconds / elapsed;
+    }
+
+    // processPCM's work for one block: read, stretch, interleave; returns ns per block
+    double stretchCost(const SampleStore& store, const int sampleRate, const float speed)
+    {
+        const int channels{store.channels()};
+        signalsmith::stretch::SignalsmithStretch<float> stretcher{};
+        stretcher.presetDefault(channels, static_cast<float>(sampleRate));
+
+        const std::size_t inputFrames{static_cast<std::size_t>(static_cast<float>(s_blockFrames) * speed + 0.5f)};
+        std::vector<std::vector<float>> input(channels, std::vector<float>(inputFrames));
+        std::vector<std::vector<float>> output(channels, std::vector<float>(s_blockFrames));
+        std::vector<float*> inputs{};
+        std::vector<float*> outputs{};
+        for (int c{0}; c < channels; ++c)
+        {
+            inputs.push_back(input[c].data());
+            outputs.push_back(output[c].data());
+        }
+        std::vector<float> interleaved(s_blockFrames * channels);
+
+        const std::size_t blocks{store.frames() / inputFrames};
+        if (blocks == 0)
+        {
+            return 0.0;
+        }
+        std::size_t readIndex{0};
+        const double elapsed{secondsOf(
+            [&]()
+            {
+                for (std::size_t b{0}; b < blocks; ++b)
+                {
+                    store.read(readIndex, inputFrames, inputs.data(), channels);
+                    stretcher.process(inputs.data(), inputFrames, outputs.data(), s_blockFrames);
+                    Kernels::interleave(outputs.data(), interleaved.data(), channels, s_blockFrames);
+                    readIndex += inputFrames;
+                }
+            })};
+        return elapsed * 1e9 / static_cast<double>(blocks);
+    }
+
+    // one block written to and read back from a ring buffer like the player's; returns ns per round trip
+    double ringBufferCost(const int channels)
+    {
+        ma_pcm_rb ringBuffer;
+        if (ma_pcm_rb_init(ma_format_f32, channels, s_blockFrames * 4, nullptr, nullptr, &ringBuffer) != MA_SUCCESS)
+        {
+            return 0.0;
+        }
+
+        std::vector<float> block(s_blockFrames * channels, 0.25f);
+        std::vector<float> out(s_blockFrames * channels);
+        constexpr int roundTrips{20000};
+        const double elapsed{secondsOf(
+            [&]()
+            {
+                for (int i{0}; i < roundTrips; ++i)
+                {
+                    // both sides can take two goes when the block straddles the wrap
+                    for (ma_uint32 written{0}; written < s_blockFrames;)
+                    {
+                        ma_uint32 frames{static_cast<ma_uint32>(s_blockFrames) - written};
+                        void* buffer;
+                        ma_pcm_rb_acquire_write(&ringBuffer, &frames, &buffer);
+                        std::memcpy(buffer, block.data() + written * channels, frames * channels * sizeof(float));
+                        ma_pcm_rb_commit_write(&ringBuffer, frames);
+                        written += frames;
+                    }
+                    for (ma_uint32 read{0}; read < s_blockFrames;)
+                    {
+                        ma_uint32 frames{static_cast<ma_uint32>(s_blockFrames) - read};
+                        void* buffer;
+                        ma_pcm_rb_acquire_read(&ringBuffer, &frames, &buffer);
+                        std::memcpy(out.data() + read * channels, buffer, frames * channels * sizeof(float));
+                        ma_pcm_rb_commit_read(&ringBuffer, frames);
+                        read += frames;
+                    }
+                }
+            })};
+        ma_pcm_rb_uninit(&ringBuffer);
+        return elapsed * 1e9 / roundTrips;
+    }
+
+    void printJson(const std::vector<Result>& results, const double seconds)
+    {
+        std::printf(
+            "{\n  \"isa\": \"%s\",\n  \"seconds\": %g,\n  \"results\": [\n",
+            Kernels::isaName(Kernels::isa()),
+            seconds);
+        for (std::size_t i{0}; i < results.size(); ++i)
+        {
+            const Result& result{results[i]};
+            std::printf(
+                "    {\"benchmark\": \"%s\", \"signal\": \"%s\", \"sampleRate\": %d, \"channels\": %d, \"speed\": %g, "
+                "\"unit\": \"%s\", \"value\": %.6g}%s\n",
+                result.benchmark.c_str(),
+                result.signal.c_str(),
+                result.sampleRate,
+                result.channels,
+                result.speed,
+                result.unit.c_str(),
+                result.value,
+                i + 1 < results.size() ? "," : "");
+        }
+        std::printf("  ]\n}\n");
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app{argc, argv};
+    const double seconds{argc > 1 ? std::atof(argv[1]) : 30.0};
+    if (seconds <= 0.0)
+    {
+        std::fprintf(stderr, "usage: %s [seconds of audio per signal]\n", argv[0]);
+        return 1;
+    }
+
+    QTemporaryDir directory{};
+    if (!directory.isValid())
+    {
+        std::fprintf(stderr, "can't create a temporary directory\n");
+        return 1;
+    }
+
+    std::vector<Result> results{};
+    const auto add{[&](Result result)
+    {
+        std::fprintf(
+            stderr,
+            "%-16s %-8s %6d Hz %d ch %5.2fx  %12.2f %s\n",
+            result.benchmark.c_str(),
+            result.signal.c_str(),
+            result.sampleRate,
+            result.channels,
+            result.speed,
+            result.value,
+            result.unit.c_str());
+        results.push_back(std::move(result));
+    }};
+
+    for (const Config& config : s_configs)
+    {
+        for (const char* signal : s_signals)
+        {
+            const std::vector<float> audio{generate(signal, config.sampleRate, config.channels, seconds)};
+            const std::size_t frames{audio.size() / config.channels};
+
+            // what loadFile() decodes, as it would come from disk
+            for (const char* extension : {"wav", "flac"})
+            {
+                const QString path{directory.filePath(QString("%1.%2").arg(signal).arg(extension))};
+                AudioEncoder encoder{};
+                if (!encoder.open(path, config.sampleRate, config.channels) ||
+                    !encoder.write(audio.data(), frames) || !encoder.close())
+                {
+                    std::fprintf(stderr, "can't write %s\n", qPrintable(path));
+                    return 1;
+                }
+
+                add({std::string{"decode-"} + extension,
+                     signal,
+                     config.sampleRate,
+                     config.channels,
+                     0.0f,
+                     "x realtime",
+                     decodeSpeed(path, 0, seconds)});
+            }
+
+            // swresample converting to a device at another rate while decoding
+            const int deviceRate{config.sampleRate == 48000 ? 44100 : 48000};
+            add({"decode-resample",
+                 signal,
+                 config.sampleRate,
+                 config.channels,
+                 0.0f,
+                 "x realtime",
+                 decodeSpeed(directory.filePath(QString("%1.wav").arg(signal)), deviceRate, seconds)});
+
+            const std::shared_ptr<SampleStore> store{makeStore(audio, config.channels)};
+
+            PeakPyramid pyramid{config.channels};
+            const double peakSeconds{secondsOf([&]() { pyramid.build(*store); })};
+            add({"peaks",
+                 signal,
+                 config.sampleRate,
+                 config.channels,
+                 0.0f,
+                 "Mframes/s",
+                 static_cast<double>(frames) / peakSeconds * 1e-6});
+
+            for (const float speed : s_speeds)
+            {
+                add({"stretch-block",
+                     signal,
+                     config.sampleRate,
+                     config.channels,
+                     speed,
+                     "ns/block",
+                     stretchCost(*store, config.sampleRate, speed)});
+            }
+        }
+
+        add({"ringbuffer", "-", config.sampleRate, config.channels, 0.0f, "ns/block", ringBufferCost(config.channels)});
+    }
+
+    printJson(results, seconds);
+    return 0;
+}
@@ -0,0 +1,479 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#include "decoder.h"
+#include "seekabledecoder.h"
+#include "wakeevent.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+#include <libswresample/swresample.h>
+#include <libavutil/opt.h>
+}
+
+namespace
+{
+    // lets FFmpeg abort blocking reads as soon as decoding is cancelled
+    int interruptCallback(void* data)
+    {
+        const std::atomic<bool>* running{static_cast<const std::atomic<bool>*>(data)};
+        return running->load() ? 0 : 1;
+    }
+
+    // what a range decoder takes at a time, so playback can start on the first one straight away
+    constexpr double s_segmentSeconds{5.0};
+    // shorter files aren't worth more than one decoder
+    constexpr std::size_t s_minSegments{6};
+    // decoded per read, and appended to the store at once
+    constexpr std::size_t s_rangeChunkFrames{1 << 14};
+} // namespace
+
+std::shared_ptr<SampleStore> Decoder::decode(
+    const QString& filePath,
+    const SampleStore::Format format,
+    const int sampleRate,
+    const int maxChannels,
+    const std::atomic<bool>& running,
+    const StartedCallback& started,
+    const DecodedCallback& decoded,
+    bool* complete)
+{
+    if (complete)
+    {
+        *complete = false;
+    }
+
+    AVFormatContext* formatContext{avformat_alloc_context()};
+    formatContext->interrupt_callback.callback = interruptCallback;
+    formatContext->interrupt_callback.opaque = const_cast<std::atomic<bool>*>(&running);
+
+    int ret{avformat_open_input(&formatContext, filePath.toStdString().c_str(), nullptr, nullptr)};
+    if (ret < 0)
+    {
+        if (running.load())
+        {
+            qWarning() << "ERROR decoding media: Failed to open file: `" << filePath << "`!";
+        }
+        return nullptr;
+    }
+
+    ret = avformat_find_stream_info(formatContext, nullptr);
+    if (ret < 0)
+    {
+        qWarning() << "ERROR decoding media: Failed to find stream info!";
+        avformat_close_input(&formatContext);
+        return nullptr;
+    }
+
+    const int streamIndex{av_find_best_stream(formatContext, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0)};
+    if (streamIndex < 0)
+    {
+        qWarning() << "ERROR decoding media: No audio stream found in `" << filePath << "`";
+        avformat_close_input(&formatContext);
+        return nullptr;
+    }
+
+    const AVStream* stream{formatContext->streams[streamIndex]};
+    const AVCodec* avDecoder{avcodec_find_decoder(stream->codecpar->codec_id)};
+    if (!avDecoder)
+    {
+        qWarning() << "ERROR decoding media: no decoder found!";
+        avformat_close_input(&formatContext);
+        return nullptr;
+    }
+
+    AVCodecContext* decoderCtx{avcodec_alloc_context3(avDecoder)};
+    avcodec_parameters_to_context(decoderCtx, stream->codecpar);
+    // frame and slice threads for the codecs that have them (most audio codecs don't)
+    decoderCtx->thread_count = 0;
+    decoderCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
+    ret = avcodec_open2(decoderCtx, avDecoder, nullptr);
+    if (ret < 0)
+    {
+        qWarning() << "ERROR decoding media: failed to open decoder!";
+        avcodec_free_context(&decoderCtx);
+        avformat_close_input(&formatContext);
+        return nullptr;
+    }
+
+    const int inputRate{decoderCtx->sample_rate};
+    const int outputRate{sampleRate > 0 ? sampleRate : inputRate};
+    const int channels{decoderCtx->ch_layout.nb_channels};
+
+    // keep the source's channel layout (mono stays mono), only downmix what the output can't play
+    const int storeChannels{std::min(channels, maxChannels)};
+    std::shared_ptr<SampleStore> store{SampleStore::create(format, storeChannels)};
+
+    AVChannelLayout inChannelLayout{decoderCtx->ch_layout};
+    if (inChannelLayout.order == AV_CHANNEL_ORDER_UNSPEC || inChannelLayout.nb_channels == 0)
+    {
+        av_channel_layout_default(&inChannelLayout, channels);
+    }
+    else
+    {
+        av_channel_layout_copy(&inChannelLayout, &decoderCtx->ch_layout);
+    }
+
+    AVChannelLayout outChannelLayout;
+    av_channel_layout_default(&outChannelLayout, storeChannels);
+
+    // one pass: sample format, sample rate and channel layout are all converted by swresample,
+    // straight into the store's own sample type
+    const AVSampleFormat outFormat{store->floatSamples() ? AV_SAMPLE_FMT_FLT : AV_SAMPLE_FMT_S16};
+    SwrContext* swrContext{swr_alloc()};
+    ret = swr_alloc_set_opts2(
+        &swrContext,
+        &outChannelLayout,
+        outFormat,
+        outputRate,
+        &inChannelLayout,
+        decoderCtx->sample_fmt,
+        inputRate,
+        0,
+        nullptr);
+
+    av_channel_layout_uninit(&inChannelLayout);
+    av_channel_layout_uninit(&outChannelLayout);
+
+    if (ret < 0 || !swrContext)
+    {
+        qWarning() << "ERROR decoding media: Failed to allocate SwrContext options!";
+        avcodec_free_context(&decoderCtx);
+        avformat_close_input(&formatContext);
+        return nullptr;
+    }
+
+    ret = swr_init(swrContext);
+    if (ret < 0)
+    {
+        qWarning() << "ERROR decoding media: swr_init() failed!";
+        swr_free(&swrContext);
+        avcodec_free_context(&decoderCtx);
+        avformat_close_input(&formatContext);
+        return nullptr;
+    }
+
+    // with matching rates swresample only converts the sample format and layout, it doesn't resample
+    if (inputRate != outputRate || channels != storeChannels)
+    {
+        qWarning() << "Input audio stream differs from device sample rate and channels...";
+        qWarning() << "Resampling while decoding (" << static_cast<float>(inputRate) * 0.001f << "kHz => "
+                   << static_cast<float>(outputRate) * 0.001f << "kHz, " << channels << " channels => "
+                   << storeChannels << " channels)";
+    }
+
+    Stream info{outputRate, storeChannels, 0.0f};
+    if (formatContext->duration != AV_NOPTS_VALUE)
+    {
+        info.estimatedDuration =
+            static_cast<float>(static_cast<double>(formatContext->duration) / static_cast<double>(AV_TIME_BASE));
+    }
+    if (started)
+    {
+        started(store, info);
+    }
+
+    AVPacket* packet{av_packet_alloc()};
+    AVFrame* frame{av_frame_alloc()};
+
+    // only used when the output doesn't fit in what's left of the store's current chunk
+    const std::size_t frameSize{static_cast<std::size_t>(av_get_bytes_per_sample(outFormat) * storeChannels)};
+    std::vector<uint8_t> scratch{};
+
+    // resamples inputSamples (nullptr to flush the resampler) and appends the result to the store
+    const auto convertSamples{[&](const uint8_t** input, const int inputSamples)
+    {
+        const int maxSamples{swr_get_out_samples(swrContext, inputSamples)};
+        if (maxSamples <= 0)
+        {
+            return 0;
+        }
+
+        std::size_t space;
+        void* dest{store->beginWrite(space)};
+        const bool direct{dest && space >= static_cast<std::size_t>(maxSamples)};
+        if (!direct)
+        {
+            scratch.resize(std::max(scratch.size(), static_cast<std::size_t>(maxSamples) * frameSize));
+            dest = scratch.data();
+        }
+
+        uint8_t* out{static_cast<uint8_t*>(dest)};
+        const int outSamples{std::max(swr_convert(swrContext, &out, maxSamples, input, inputSamples), 0)};
+
+        if (direct)
+        {
+            store->endWrite(static_cast<std::size_t>(outSamples));
+        }
+        else
+        {
+            store->appendNative(dest, static_cast<std::size_t>(outSamples));
+        }
+        return outSamples;
+    }};
+
+    const auto receiveFrames{[&]()
+    {
+        while (running.load() && avcodec_receive_frame(decoderCtx, frame) >= 0)
+        {
+            convertSamples(const_cast<const uint8_t**>(frame->extended_data), frame->nb_samples);
+        }
+    }};
+
+    while (running.load() && av_read_frame(formatContext, packet) >= 0)
+    {
+        if (packet->stream_index != streamIndex)
+        {
+            av_packet_unref(packet);
+            continue;
+        }
+
+        ret = avcodec_send_packet(decoderCtx, packet);
+        av_packet_unref(packet);
+        if (ret < 0 && (ret != AVERROR(EAGAIN)))
+        {
+            qWarning() << "Failed to decode frame!";
+            continue;
+        }
+
+        receiveFrames();
+        if (decoded)
+        {
+            decoded();
+        }
+    }
+
+    if (running.load())
+    {
+        // drain the decoder, then the resampler
+        avcodec_send_packet(decoderCtx, nullptr);
+        receiveFrames();
+        while (convertSamples(nullptr, 0) > 0)
+        {
+        }
+    }
+
+    // tidy up
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    swr_free(&swrContext);
+    avcodec_free_context(&decoderCtx);
+    avformat_close_input(&formatContext);
+
+    if (complete)
+    {
+        *complete = running.load();
+    }
+    return store;
+}
+
+std::shared_ptr<SampleStore> Decoder::decodeParallel(
+    const QString& filePath,
+    const SampleStore::Format format,
+    const int sampleRate,
+    const int maxChannels,
+    const std::atomic<bool>& running,
+    const StartedCallback& started,
+    const DecodedCallback& decoded,
+    bool* complete,
+    int threads)
+{
+    if (threads <= 0)
+    {
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    // only reads the header, the segments are cut from the length the container gives
+    std::unique_ptr<SeekableDecoder> first{
+        threads > 1 ? SeekableDecoder::open(filePath, sampleRate, maxChannels, running) : nullptr};
+    const std::shared_ptr<const SeekIndex> index{first ? first->index() : nullptr};
+    const std::size_t segmentFrames{index ? static_cast<std::size_t>(s_segmentSeconds * index->sampleRate) : 0};
+    const std::size_t segments{index && segmentFrames > 0 ? index->frames / segmentFrames : 0};
+    if (!running.load())
+    {
+        if (complete)
+        {
+            *complete = false;
+        }
+        return nullptr;
+    }
+    if (segments < s_minSegments)
+    {
+        first.reset();
+        return decode(filePath, format, sampleRate, maxChannels, running, started, decoded, complete);
+    }
+
+    if (complete)
+    {
+        *complete = false;
+    }
+
+    const std::shared_ptr<SampleStore> store{SampleStore::create(format, index->channels)};
+    if (started)
+    {
+        started(
+            store,
+            Stream{
+                index->sampleRate,
+                index->channels,
+                static_cast<float>(static_cast<double>(index->frames) / static_cast<double>(index->sampleRate))});
+    }
+
+    // Every segment is decoded into a store of its own, which the stitcher copies into the result while it is still
+    // being decoded and then drops. Segments are taken in order and no further than window ahead of the one being
+    // stitched, so on top of the result there are never more than window segments in memory.
+    const std::size_t workerCount{std::min(static_cast<std::size_t>(threads), segments)};
+    const std::size_t window{workerCount * 2};
+    std::vector<std::shared_ptr<SampleStore>> parts(segments);
+    std::mutex mutex{};
+    std::condition_variable taken{};
+    std::size_t next{0};
+    std::size_t stitched{0};
+    bool stopped{false};
+    WakeEvent progress{};
+
+    std::vector<std::thread> workers{};
+    for (std::size_t w{0}; w < workerCount; ++w)
+    {
+        workers.emplace_back(
+            [&, decoder = w == 0 ? std::move(first) : nullptr]() mutable
+            {
+                if (!decoder)
+                {
+                    decoder = SeekableDecoder::open(filePath, sampleRate, maxChannels, running, index);
+                }
+
+                std::vector<float> chunk(s_rangeChunkFrames * index->channels);
+                while (true)
+                {
+                    std::unique_lock lock{mutex};
+                    taken.wait(lock, [&]() { return stopped || next >= segments || next < stitched + window; });
+                    if (stopped || next >= segments)
+                    {
+                        return;
+                    }
+                    const std::size_t segment{next++};
+                    const std::shared_ptr<SampleStore> part{SampleStore::create(format, index->channels)};
+                    parts[segment] = part;
+                    lock.unlock();
+                    progress.signal();
+
+                    const std::size_t start{segmentFrames * segment};
+                    // the last segment runs until the decoder runs out, the container's length is an estimate
+                    const std::size_t end{segment + 1 < segments ? start + segmentFrames : 0};
+                    if (decoder && (decoder->position() == start || decoder->seek(start)))
+                    {
+                        std::size_t position{start};
+                        while (running.load() && (end == 0 || position < end))
+                        {
+                            const std::size_t wanted{
+                                end == 0 ? s_rangeChunkFrames : std::min(s_rangeChunkFrames, end - position)};
+                            const std::size_t read{decoder->read(chunk.data(), wanted)};
+                            part->append(chunk.data(), read);
+                            position += read;
+                            progress.signal();
+                            if (read < wanted)
+                            {
+                                break;
+                            }
+                        }
+                    }
+                    part->finish();
+                    progress.signal();
+                }
+            });
+    }
+
+    // stitch the segments together in order, each one as soon as it has something new
+    std::vector<float> chunk(s_rangeChunkFrames * index->channels);
+    // a segment cut short keeps its length so everything after it stays in place, unless nothing comes after it
+    std::size_t owed{0};
+    for (std::size_t s{0}; s < segments && running.load(); ++s)
+    {
+        std::shared_ptr<SampleStore> part{};
+        while (running.load())
+        {
+            {
+                const std::lock_guard lock{mutex};
+                part = parts[s];
+            }
+            if (part)
+            {
+                break;
+            }
+            progress.wait();
+        }
+
+        std::size_t copied{0};
+        while (part)
+        {
+            const bool finished{part->finished()};
+            const std::size_t available{part->frames()};
+            if (copied < available && owed > 0)
+            {
+                std::fill(chunk.begin(), chunk.end(), 0.0f);
+                for (std::size_t written{0}; written < owed;)
+                {
+                    const std::size_t silence{std::min(s_rangeChunkFrames, owed - written)};
+                    store->append(chunk.data(), silence);
+                    written += silence;
+                }
+                owed = 0;
+            }
+            while (copied < available)
+            {
+                const std::size_t read{
+                    part->readInterleaved(copied, std::min(s_rangeChunkFrames, available - copied), chunk.data())};
+                store->append(chunk.data(), read);
+                copied += read;
+            }
+            if (copied > 0 && decoded)
+            {
+                decoded();
+            }
+            if (finished || !running.load())
+            {
+                break;
+            }
+            progress.wait();
+        }
+        if (s + 1 < segments && copied < segmentFrames)
+        {
+            owed += segmentFrames - copied;
+        }
+
+        {
+            // nothing reads it anymore
+            const std::lock_guard lock{mutex};
+            parts[s].reset();
+            stitched = s + 1;
+        }
+        taken.notify_all();
+    }
+
+    {
+        const std::lock_guard lock{mutex};
+        stopped = true;
+    }
+    taken.notify_all();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    if (complete)
+    {
+        *complete = running.load();
+    }
+    return store;
+}
@@ -0,0 +1,61 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_DECODER_H
+#define SPEEDSHIFTER_DECODER_H
+
+#include "samplestore.h"
+
+#include <QString>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// FFmpeg decode of a file's best audio stream into a SampleStore.
+// Used by Player for playback and by the offline render tools.
+namespace Decoder
+{
+    struct Stream
+    {
+        int sampleRate{0};             // of the store, after resampling
+        int channels{0};               // of the store, after downmixing
+        float estimatedDuration{0.0f}; // from the container, 0 if unknown
+    };
+
+    // called once the stream has been opened, before anything is appended to store
+    using StartedCallback = std::function<void(const std::shared_ptr<SampleStore>& store, const Stream& stream)>;
+    // called after every packet whose samples were appended
+    using DecodedCallback = std::function<void()>;
+
+    // Decodes filePath resampled to sampleRate (0 keeps the file's rate) and downmixed to at most maxChannels.
+    // Stops early as soon as running is cleared, blocking reads included; complete tells whether it got to the end.
+    // Returns the store (nullptr if the file couldn't be opened), finishing it is up to the caller.
+    std::shared_ptr<SampleStore> decode(
+        const QString& filePath,
+        SampleStore::Format format,
+        int sampleRate,
+        int maxChannels,
+        const std::atomic<bool>& running,
+        const StartedCallback& started,
+        const DecodedCallback& decoded,
+        bool* complete = nullptr);
+
+    // Same as decode(), but seekable files are cut into short segments by the length in their header, which up to
+    // threads single-threaded decoders (0: every core) take in order and decode at once, each from its own seek point
+    // ahead of its segment so the codec and the resampler have settled by its first frame. Segments meet at exact
+    // frame positions and are appended to the store in order as they come in, so playback can start on the first one
+    // straight away. Decoders stay at most a few segments ahead of the store.
+    // Falls back to decode() for short files and files without a known length.
+    std::shared_ptr<SampleStore> decodeParallel(
+        const QString& filePath,
+        SampleStore::Format format,
+        int sampleRate,
+        int maxChannels,
+        const std::atomic<bool>& running,
+        const StartedCallback& started,
+        const DecodedCallback& decoded,
+        bool* complete = nullptr,
+        int threads = 0);
+} // namespace Decoder
+
+#endif // SPEEDSHIFTER_DECODER_H
@@ -0,0 +1,251 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#include "encoder.h"
+
+#include <QDebug>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+#include <libswresample/swresample.h>
+}
+
+// frames per encoded frame for codecs that take any size (PCM)
+#define ENCODER_FRAME_SIZE 4096
+
+AudioEncoder::~AudioEncoder() { release(); }
+
+bool AudioEncoder::open(const QString& filePath, const int sampleRate, const int channels)
+{
+    release();
+
+    const std::string path{filePath.toStdString()};
+    if (avformat_alloc_output_context2(&m_formatContext, nullptr, nullptr, path.c_str()) < 0 || !m_formatContext)
+    {
+        qWarning() << "ERROR encoding: unknown output format for `" << filePath << "`!";
+        return false;
+    }
+
+    const AVCodec* codec{avcodec_find_encoder(m_formatContext->oformat->audio_codec)};
+    if (!codec)
+    {
+        qWarning() << "ERROR encoding: no audio encoder for `" << filePath << "`!";
+        release();
+        return false;
+    }
+
+    m_stream = avformat_new_stream(m_formatContext, nullptr);
+    m_codecContext = avcodec_alloc_context3(codec);
+    if (!m_stream || !m_codecContext)
+    {
+        qWarning() << "ERROR encoding: failed to allocate the encoder!";
+        release();
+        return false;
+    }
+
+    // the codec's preferred format, 16 bit for both PCM in WAV and FLAC
+    m_codecContext->sample_fmt = codec->sample_fmts ? codec->sample_fmts[0] : AV_SAMPLE_FMT_S16;
+    m_codecContext->sample_rate = sampleRate;
+    m_codecContext->time_base = {1, sampleRate};
+    av_channel_layout_default(&m_codecContext->ch_layout, channels);
+    if (m_formatContext->oformat->flags & AVFMT_GLOBALHEADER)
+    {
+        m_codecContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    if (avcodec_open2(m_codecContext, codec, nullptr) < 0)
+    {
+        qWarning() << "ERROR encoding: failed to open the encoder!";
+        release();
+        return false;
+    }
+
+    avcodec_parameters_from_context(m_stream->codecpar, m_codecContext);
+    m_stream->time_base = m_codecContext->time_base;
+
+    if (!(m_formatContext->oformat->flags & AVFMT_NOFILE) &&
+        avio_open(&m_formatContext->pb, path.c_str(), AVIO_FLAG_WRITE) < 0)
+    {
+        qWarning() << "ERROR encoding: failed to open `" << filePath << "` for writing!";
+        release();
+        return false;
+    }
+
+    if (avformat_write_header(m_formatContext, nullptr) < 0)
+    {
+        qWarning() << "ERROR encoding: failed to write the header!";
+        release();
+        return false;
+    }
+
+    // only converts the sample format, rate and layout stay the same
+    if (swr_alloc_set_opts2(
+            &m_swrContext,
+            &m_codecContext->ch_layout,
+            m_codecContext->sample_fmt,
+            sampleRate,
+            &m_codecContext->ch_layout,
+            AV_SAMPLE_FMT_FLT,
+            sampleRate,
+            0,
+            nullptr) < 0 ||
+        swr_init(m_swrContext) < 0)
+    {
+        qWarning() << "ERROR encoding: failed to set up SwrContext!";
+        release();
+        return false;
+    }
+
+    const bool variableSize{(codec->capabilities & AV_CODEC_CAP_VARIABLE_FRAME_SIZE) != 0};
+    m_frameSize = m_codecContext->frame_size > 0 && !variableSize ? m_codecContext->frame_size : ENCODER_FRAME_SIZE;
+    m_channels = channels;
+    m_pts = 0;
+    m_pending.clear();
+
+    m_frame = av_frame_alloc();
+    m_packet = av_packet_alloc();
+    m_frame->nb_samples = m_frameSize;
+    m_frame->format = m_codecContext->sample_fmt;
+    m_frame->sample_rate = sampleRate;
+    av_channel_layout_copy(&m_frame->ch_layout, &m_codecContext->ch_layout);
+    if (av_frame_get_buffer(m_frame, 0) < 0)
+    {
+        qWarning() << "ERROR encoding: failed to allocate frame buffers!";
+        release();
+        return false;
+    }
+
+    return true;
+}
+
+bool AudioEncoder::write(const float* interleaved, const std::size_t frames)
+{
+    if (!m_codecContext)
+    {
+        return false;
+    }
+
+    const std::size_t frameSize{static_cast<std::size_t>(m_frameSize)};
+    std::size_t offset{0};
+
+    // complete the leftover frame first
+    if (!m_pending.empty())
+    {
+        const std::size_t missing{frameSize - m_pending.size() / m_channels};
+        const std::size_t taken{std::min(missing, frames)};
+        m_pending.insert(m_pending.end(), interleaved, interleaved + taken * m_channels);
+        offset = taken;
+        if (m_pending.size() / m_channels < frameSize)
+        {
+            return true;
+        }
+        if (!encodeFrames(m_pending.data(), m_frameSize))
+        {
+            return false;
+        }
+        m_pending.clear();
+    }
+
+    // whole frames straight from the caller's buffer
+    for (; offset + frameSize <= frames; offset += frameSize)
+    {
+        if (!encodeFrames(interleaved + offset * m_channels, m_frameSize))
+        {
+            return false;
+        }
+    }
+
+    m_pending.insert(m_pending.end(), interleaved + offset * m_channels, interleaved + frames * m_channels);
+    return true;
+}
+
+bool AudioEncoder::close()
+{
+    if (!m_codecContext)
+    {
+        return false;
+    }
+
+    bool ok{true};
+    if (!m_pending.empty())
+    {
+        ok = encodeFrames(m_pending.data(), static_cast<int>(m_pending.size() / m_channels));
+        m_pending.clear();
+    }
+
+    ok = encode(nullptr) && ok;
+    ok = av_write_trailer(m_formatContext) == 0 && ok;
+    release();
+    return ok;
+}
+
+bool AudioEncoder::encodeFrames(const float* interleaved, const int frames)
+{
+    if (av_frame_make_writable(m_frame) < 0)
+    {
+        return false;
+    }
+
+    const uint8_t* input{reinterpret_cast<const uint8_t*>(interleaved)};
+    const int converted{swr_convert(m_swrContext, m_frame->data, frames, &input, frames)};
+    if (converted < 0)
+    {
+        qWarning() << "ERROR encoding: failed to convert samples!";
+        return false;
+    }
+
+    m_frame->nb_samples = converted;
+    m_frame->pts = m_pts;
+    m_pts += converted;
+    return encode(m_frame);
+}
+
+bool AudioEncoder::encode(AVFrame* frame)
+{
+    if (avcodec_send_frame(m_codecContext, frame) < 0)
+    {
+        qWarning() << "ERROR encoding: failed to send frame!";
+        return false;
+    }
+
+    while (true)
+    {
+        const int ret{avcodec_receive_packet(m_codecContext, m_packet)};
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+        {
+            return true;
+        }
+        if (ret < 0)
+        {
+            qWarning() << "ERROR encoding: failed to encode frame!";
+            return false;
+        }
+
+        av_packet_rescale_ts(m_packet, m_codecContext->time_base, m_stream->time_base);
+        m_packet->stream_index = m_stream->index;
+        if (av_interleaved_write_frame(m_formatContext, m_packet) < 0)
+        {
+            qWarning() << "ERROR encoding: failed to write packet!";
+            return false;
+        }
+    }
+}
+
+void AudioEncoder::release()
+{
+    av_packet_free(&m_packet);
+    av_frame_free(&m_frame);
+    swr_free(&m_swrContext);
+    avcodec_free_context(&m_codecContext);
+    if (m_formatContext)
+    {
+        if (!(m_formatContext->oformat->flags & AVFMT_NOFILE))
+        {
+            avio_closep(&m_formatContext->pb);
+        }
+        avformat_free_context(m_formatContext);
+        m_formatContext = nullptr;
+    }
+    m_stream = nullptr;
+}
@@ -0,0 +1,56 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_ENCODER_H
+#define SPEEDSHIFTER_ENCODER_H
+
+#include <QString>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVStream;
+struct AVFrame;
+struct AVPacket;
+struct SwrContext;
+
+// Writes interleaved float audio to a file through FFmpeg.
+// The container and codec follow the file's extension (.wav is 16 bit PCM, .flac is FLAC).
+class AudioEncoder
+{
+public:
+    AudioEncoder() = default;
+    ~AudioEncoder();
+
+    AudioEncoder(const AudioEncoder&) = delete;
+    AudioEncoder& operator=(const AudioEncoder&) = delete;
+
+    bool open(const QString& filePath, int sampleRate, int channels);
+    bool write(const float* interleaved, std::size_t frames);
+    // encodes what's left and writes the trailer, the file is only complete after this
+    bool close();
+
+private:
+    // converts frames interleaved frames into m_frame and encodes it
+    bool encodeFrames(const float* interleaved, int frames);
+    // nullptr flushes the encoder
+    bool encode(AVFrame* frame);
+    void release();
+
+    AVFormatContext* m_formatContext{nullptr};
+    AVCodecContext* m_codecContext{nullptr};
+    AVStream* m_stream{nullptr};
+    SwrContext* m_swrContext{nullptr};
+    AVFrame* m_frame{nullptr};
+    AVPacket* m_packet{nullptr};
+
+    int m_channels{0};
+    int m_frameSize{0}; // frames per encoded frame
+    std::int64_t m_pts{0};
+    // less than a whole frame left over from write()
+    std::vector<float> m_pending{};
+};
+
+#endif // SPEEDSHIFTER_ENCODER_H
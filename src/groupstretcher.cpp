@@ -0,0 +1,258 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#include "groupstretcher.h"
+#include "kernels.h"
+
+#include <algorithm>
+
+namespace
+{
+    // interleaved frames as the planar channels signalsmith writes to, out[channel][frame]. Stride is the channel
+    // count for the common layouts, so every index is a multiple of a constant (0 for any other, taken from stride).
+    template <int Stride>
+    struct InterleavedChannels
+    {
+        struct Channel
+        {
+            float* first;
+            int stride;
+            float& operator[](const int frame) const { return first[frame * (Stride > 0 ? Stride : stride)]; }
+        };
+
+        float* frames;
+        int stride;
+        Channel operator[](const int channel) const { return {frames + channel, stride}; }
+    };
+
+    template <int Stride>
+    void stretchInterleaved(
+        signalsmith::stretch::SignalsmithStretch<float>& stretch,
+        const float* const* inputs,
+        const int inputFrames,
+        float* output,
+        const int stride,
+        const int outputFrames)
+    {
+        stretch.process(inputs, inputFrames, InterleavedChannels<Stride>{output, stride}, outputFrames);
+    }
+} // namespace
+
+GroupStretcher::~GroupStretcher()
+{
+    stopHelpers();
+}
+
+void GroupStretcher::presetDefault(const int channels, const float sampleRate)
+{
+    configureGroups(
+        channels,
+        [sampleRate](signalsmith::stretch::SignalsmithStretch<float>& stretch, const int groupChannels)
+        { stretch.presetDefault(groupChannels, sampleRate); });
+}
+
+void GroupStretcher::presetCheaper(const int channels, const float sampleRate)
+{
+    configureGroups(
+        channels,
+        [sampleRate](signalsmith::stretch::SignalsmithStretch<float>& stretch, const int groupChannels)
+        { stretch.presetCheaper(groupChannels, sampleRate); });
+}
+
+void GroupStretcher::configure(const int channels, const int blockSamples, const int intervalSamples)
+{
+    configureGroups(
+        channels,
+        [blockSamples, intervalSamples](
+            signalsmith::stretch::SignalsmithStretch<float>& stretch,
+            const int groupChannels) { stretch.configure(groupChannels, blockSamples, intervalSamples); });
+}
+
+int GroupStretcher::groupedChannels(const int channels) const
+{
+    const int groups{(std::max(channels, 1) + s_groupChannels - 1) / s_groupChannels};
+    return std::min(groups * s_groupChannels, m_channels);
+}
+
+void GroupStretcher::reset()
+{
+    for (int g{0}; g < m_groupCount; ++g)
+    {
+        m_groups[g].stretch.reset();
+    }
+}
+
+void GroupStretcher::seek(const float* const* inputs, const int inputFrames, const double playbackRate, int channels)
+{
+    // only after a seek or a loop wrap, not worth waking the helpers for
+    channels = groupedChannels(channels);
+    for (int g{0}; g < m_groupCount && m_groups[g].first < channels; ++g)
+    {
+        m_groups[g].stretch.seek(inputs + m_groups[g].first, inputFrames, playbackRate);
+    }
+}
+
+void GroupStretcher::process(
+    const float* const* inputs,
+    const int inputFrames,
+    float* const* outputs,
+    const int outputFrames,
+    const int channels)
+{
+    const int stretched{groupedChannels(channels)};
+    const int groups{(stretched + s_groupChannels - 1) / s_groupChannels};
+    m_job = {inputs, inputFrames, outputs, nullptr, outputFrames, groups};
+    runJob();
+
+    for (int c{stretched}; c < m_channels; ++c)
+    {
+        Kernels::zero(outputs[c], static_cast<std::size_t>(outputFrames));
+    }
+}
+
+void GroupStretcher::processInterleaved(
+    const float* const* inputs,
+    const int inputFrames,
+    float* output,
+    const int outputFrames,
+    const int channels)
+{
+    const int stretched{groupedChannels(channels)};
+    const int groups{(stretched + s_groupChannels - 1) / s_groupChannels};
+    m_job = {inputs, inputFrames, nullptr, output, outputFrames, groups};
+    runJob();
+
+    if (stretched < m_channels)
+    {
+        for (int f{0}; f < outputFrames; ++f)
+        {
+            std::fill(output + f * m_channels + stretched, output + (f + 1) * m_channels, 0.0f);
+        }
+    }
+}
+
+template <typename Configure>
+void GroupStretcher::configureGroups(const int channels, const Configure& configure)
+{
+    const int count{std::clamp(channels, 1, s_maxChannels)};
+    const int groups{(count + s_groupChannels - 1) / s_groupChannels};
+    const bool regroup{groups != m_groupCount};
+    if (regroup)
+    {
+        stopHelpers();
+    }
+
+    m_channels = count;
+    m_groupCount = groups;
+    for (int g{0}; g < groups; ++g)
+    {
+        Group& group{m_groups[g]};
+        group.first = g * s_groupChannels;
+        group.channels = std::min(s_groupChannels, count - group.first);
+        configure(group.stretch, group.channels);
+    }
+
+    if (regroup)
+    {
+        startHelpers();
+    }
+}
+
+void GroupStretcher::startHelpers()
+{
+    // a single group (or a single core) has nobody to share the work with
+    if (m_groupCount < 2 || std::thread::hardware_concurrency() < 2)
+    {
+        return;
+    }
+
+    m_helping.store(true);
+    for (int g{1}; g < m_groupCount; ++g)
+    {
+        m_groups[g].helper = std::thread(&GroupStretcher::help, this, static_cast<std::size_t>(g));
+    }
+}
+
+void GroupStretcher::stopHelpers()
+{
+    m_helping.store(false);
+    for (Group& group : m_groups)
+    {
+        if (group.helper.joinable())
+        {
+            group.wake.signal();
+            group.helper.join();
+        }
+    }
+}
+
+void GroupStretcher::help(const std::size_t index)
+{
+    Group& group{m_groups[index]};
+    while (true)
+    {
+        group.wake.wait();
+        if (!m_helping.load())
+        {
+            return;
+        }
+
+        runGroup(group);
+        if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            m_done.signal();
+        }
+    }
+}
+
+void GroupStretcher::runJob()
+{
+    if (!m_helping.load(std::memory_order_relaxed) || m_job.groups < 2)
+    {
+        for (int g{0}; g < m_job.groups; ++g)
+        {
+            runGroup(m_groups[g]);
+        }
+        return;
+    }
+
+    // waking a helper publishes m_job to it
+    m_remaining.store(m_job.groups - 1, std::memory_order_relaxed);
+    for (int g{1}; g < m_job.groups; ++g)
+    {
+        m_groups[g].wake.signal();
+    }
+    runGroup(m_groups[0]);
+
+    // the barrier, a signal left over from the last block just goes round once more
+    while (m_remaining.load(std::memory_order_acquire) > 0)
+    {
+        m_done.wait();
+    }
+}
+
+void GroupStretcher::runGroup(Group& group)
+{
+    const float* const* inputs{m_job.inputs + group.first};
+    if (!m_job.interleaved)
+    {
+        group.stretch.process(inputs, m_job.inputFrames, m_job.outputs + group.first, m_job.outputFrames);
+        return;
+    }
+
+    float* output{m_job.interleaved + group.first};
+    switch (m_channels)
+    {
+    case 2:
+        stretchInterleaved<2>(group.stretch, inputs, m_job.inputFrames, output, m_channels, m_job.outputFrames);
+        break;
+    case 6:
+        stretchInterleaved<6>(group.stretch, inputs, m_job.inputFrames, output, m_channels, m_job.outputFrames);
+        break;
+    case 8:
+        stretchInterleaved<8>(group.stretch, inputs, m_job.inputFrames, output, m_channels, m_job.outputFrames);
+        break;
+    default:
+        stretchInterleaved<0>(group.stretch, inputs, m_job.inputFrames, output, m_channels, m_job.outputFrames);
+        break;
+    }
+}
@@ -0,0 +1,99 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_GROUPSTRETCHER_H
+#define SPEEDSHIFTER_GROUPSTRETCHER_H
+
+#include <signalsmith-stretch.h>
+
+#include "wakeevent.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+// Time stretcher for up to 7.1, made of independent signalsmith stretchers for pairs of channels (and a mono one
+// for an odd channel out). A pair follows the usual layouts: front left/right, centre/LFE, back, side. One
+// stretcher analyses all of its channels together, so its cost grows with the channel count, while the pairs of a
+// surround layout are stretched on helper threads in parallel. The calling thread stretches the first pair itself
+// and waits for the others at the end of every block, so a block is done when process() returns.
+// Configuring it (re)starts the helpers and allocates, everything else is the caller's thread and the helpers only.
+class GroupStretcher
+{
+public:
+    static constexpr int s_maxChannels{8};
+    static constexpr int s_groupChannels{2};
+    static constexpr int s_maxGroups{s_maxChannels / s_groupChannels};
+
+    GroupStretcher() = default;
+    ~GroupStretcher();
+
+    GroupStretcher(const GroupStretcher&) = delete;
+    GroupStretcher& operator=(const GroupStretcher&) = delete;
+
+    // same as signalsmith's, for every group
+    void presetDefault(int channels, float sampleRate);
+    void presetCheaper(int channels, float sampleRate);
+    void configure(int channels, int blockSamples, int intervalSamples);
+
+    [[nodiscard]] int channels() const { return m_channels; }
+    // the first n channels rounded up to whole groups, what process() has to be given to stretch n of them
+    [[nodiscard]] int groupedChannels(int channels) const;
+
+    // every group is configured the same, so these are the first one's
+    [[nodiscard]] int blockSamples() const { return m_groups[0].stretch.blockSamples(); }
+    [[nodiscard]] int intervalSamples() const { return m_groups[0].stretch.intervalSamples(); }
+    [[nodiscard]] int inputLatency() const { return m_groups[0].stretch.inputLatency(); }
+    [[nodiscard]] int outputLatency() const { return m_groups[0].stretch.outputLatency(); }
+
+    void reset();
+    // inputs[channels][inputFrames], see signalsmith's seek()
+    void seek(const float* const* inputs, int inputFrames, double playbackRate, int channels);
+    // inputs[channels][inputFrames] -> outputs[channels()][outputFrames], only the first channels (see
+    // groupedChannels()) are stretched and the rest is silence
+    void process(const float* const* inputs, int inputFrames, float* const* outputs, int outputFrames, int channels);
+    // same, into interleaved [outputFrames * channels()]
+    void processInterleaved(const float* const* inputs, int inputFrames, float* output, int outputFrames, int channels);
+
+private:
+    struct Group
+    {
+        signalsmith::stretch::SignalsmithStretch<float> stretch{};
+        int first{0}; // channel
+        int channels{0};
+        WakeEvent wake{};
+        std::thread helper{};
+    };
+
+    // the block every group works on, set before the helpers are woken
+    struct Job
+    {
+        const float* const* inputs{nullptr};
+        int inputFrames{0};
+        float* const* outputs{nullptr}; // planar, or
+        float* interleaved{nullptr};
+        int outputFrames{0};
+        int groups{0}; // with audio, from the first one on
+    };
+
+    template <typename Configure>
+    void configureGroups(int channels, const Configure& configure);
+    void startHelpers();
+    void stopHelpers();
+    void help(std::size_t index);
+    // runs m_job for every group, in parallel if there are helpers
+    void runJob();
+    void runGroup(Group& group);
+
+    std::array<Group, s_maxGroups> m_groups{};
+    int m_channels{0};
+    int m_groupCount{0};
+
+    Job m_job{};
+    std::atomic<bool> m_helping{false};
+    // groups the helpers haven't finished yet, the last one to finish signals m_done
+    std::atomic<int> m_remaining{0};
+    WakeEvent m_done{};
+};
+
+#endif // SPEEDSHIFTER_GROUPSTRETCHER_H
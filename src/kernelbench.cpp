@@ -0,0 +1,108 @@
+// Created by Jens Kromdijk 17/10/2026
+
+// Per-block cost of the audio path kernels for every instruction set this CPU supports.
+// (Kernels::zero() isn't listed, it's memset on every instruction set)
+// usage: speedshifter-kernelbench [frames per block] [channels]
+
+#include "kernels.h"
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+namespace
+{
+    constexpr int s_blocks{20000};
+
+    // average ns per call of run, best of a few rounds
+    double measure(const std::function<void()>& run)
+    {
+        double best{0.0};
+        for (int round{0}; round < 5; ++round)
+        {
+            const auto start{std::chrono::steady_clock::now()};
+            for (int i{0}; i < s_blocks; ++i)
+            {
+                run();
+            }
+            const std::chrono::duration<double, std::nano> elapsed{std::chrono::steady_clock::now() - start};
+
+            const double perBlock{elapsed.count() / s_blocks};
+            best = round == 0 ? perBlock : std::min(best, perBlock);
+        }
+        return best;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const std::size_t frames{argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1024};
+    const int channels{argc > 2 ? std::atoi(argv[2]) : 2};
+    if (frames == 0 || channels <= 0 || channels > 8)
+    {
+        std::fprintf(stderr, "usage: %s [frames per block] [channels (1-8)]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<float> interleaved(frames * channels);
+    std::vector<std::int16_t> interleaved16(frames * channels);
+    for (std::size_t i{0}; i < interleaved.size(); ++i)
+    {
+        interleaved[i] = std::sin(static_cast<float>(i) * 0.01f);
+        interleaved16[i] = static_cast<std::int16_t>(interleaved[i] * 32767.0f);
+    }
+
+    std::vector<std::vector<float>> planar(channels, std::vector<float>(frames));
+    std::array<float*, 8> out{};
+    std::array<const float*, 8> in{};
+    for (int c{0}; c < channels; ++c)
+    {
+        out[c] = planar[c].data();
+        in[c] = planar[c].data();
+    }
+
+    std::array<float, 8> low{};
+    std::array<float, 8> high{};
+
+    struct Kernel
+    {
+        const char* name;
+        std::function<void()> run;
+    };
+    const std::array<Kernel, 4> kernels{{
+        {"deinterleave (float)", [&]() { Kernels::deinterleave(interleaved.data(), out.data(), channels, frames); }},
+        {"deinterleave (int16)", [&]() { Kernels::deinterleave(interleaved16.data(), out.data(), channels, frames); }},
+        {"interleave", [&]() { Kernels::interleave(in.data(), interleaved.data(), channels, frames); }},
+        {"min/max", [&]() { Kernels::minMax(interleaved.data(), channels, frames, low.data(), high.data()); }},
+    }};
+
+    std::printf("%zu frames x %d channels per block, best of 5 x %d blocks\n\n", frames, channels, s_blocks);
+    std::printf("%-22s %10s %12s %9s\n", "kernel", "isa", "ns / block", "speedup");
+
+    for (const Kernel& kernel : kernels)
+    {
+        double scalar{0.0};
+        for (const Kernels::Isa isa :
+             {Kernels::Isa::Scalar, Kernels::Isa::SSE2, Kernels::Isa::AVX2, Kernels::Isa::NEON})
+        {
+            if (!Kernels::setIsa(isa))
+            {
+                continue;
+            }
+
+            const double ns{measure(kernel.run)};
+            if (isa == Kernels::Isa::Scalar)
+            {
+                scalar = ns;
+            }
+            std::printf("%-22s %10s %12.1f %8.2fx\n", kernel.name, Kernels::isaName(isa), ns, scalar / ns);
+        }
+    }
+
+    // keeps the results alive
+    return low[0] > high[0] ? 2 : 0;
+}
@@ -0,0 +1,725 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#include "kernels.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+// SSE2 is part of x86-64, AVX2 has to be checked for
+#define KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define KERNELS_AVX2_TARGET
+#else
+#define KERNELS_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+// NEON is part of AArch64
+#define KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+    // the vector loops multiply by the reciprocal
+    constexpr float s_int16Scale{1.0f / Kernels::s_int16Max};
+
+    struct Table
+    {
+        Kernels::Isa isa;
+        void (*deinterleave)(const float*, float* const*, int, std::size_t);
+        void (*deinterleave16)(const std::int16_t*, float* const*, int, std::size_t);
+        void (*interleave)(const float* const*, float*, int, std::size_t);
+        void (*toFloat)(const std::int16_t*, float*, std::size_t);
+        void (*minMax)(const float*, int, std::size_t, float*, float*);
+    };
+
+    namespace scalar
+    {
+        // surround layouts, the channel count is a constant so every frame's inner loop unrolls
+        template <int Channels>
+        void deinterleaveFixed(const float* in, float* const* out, const std::size_t frames)
+        {
+            for (std::size_t i{0}; i < frames; ++i)
+            {
+                for (int c{0}; c < Channels; ++c)
+                {
+                    out[c][i] = in[i * Channels + c];
+                }
+            }
+        }
+
+        template <int Channels>
+        void interleaveFixed(const float* const* in, float* out, const std::size_t frames)
+        {
+            for (std::size_t i{0}; i < frames; ++i)
+            {
+                for (int c{0}; c < Channels; ++c)
+                {
+                    out[i * Channels + c] = in[c][i];
+                }
+            }
+        }
+
+        void deinterleave(const float* in, float* const* out, const int channels, const std::size_t frames)
+        {
+            if (channels == 6)
+            {
+                deinterleaveFixed<6>(in, out, frames);
+                return;
+            }
+            if (channels == 8)
+            {
+                deinterleaveFixed<8>(in, out, frames);
+                return;
+            }
+
+            for (int c{0}; c < channels; ++c)
+            {
+                float* dest{out[c]};
+                for (std::size_t i{0}; i < frames; ++i)
+                {
+                    dest[i] = in[i * channels + c];
+                }
+            }
+        }
+
+        void deinterleave16(const std::int16_t* in, float* const* out, const int channels, const std::size_t frames)
+        {
+            for (int c{0}; c < channels; ++c)
+            {
+                float* dest{out[c]};
+                for (std::size_t i{0}; i < frames; ++i)
+                {
+                    dest[i] = static_cast<float>(in[i * channels + c]) * s_int16Scale;
+                }
+            }
+        }
+
+        void interleave(const float* const* in, float* out, const int channels, const std::size_t frames)
+        {
+            if (channels == 6)
+            {
+                interleaveFixed<6>(in, out, frames);
+                return;
+            }
+            if (channels == 8)
+            {
+                interleaveFixed<8>(in, out, frames);
+                return;
+            }
+
+            for (int c{0}; c < channels; ++c)
+            {
+                const float* source{in[c]};
+                for (std::size_t i{0}; i < frames; ++i)
+                {
+                    out[i * channels + c] = source[i];
+                }
+            }
+        }
+
+        void toFloat(const std::int16_t* in, float* out, const std::size_t count)
+        {
+            for (std::size_t i{0}; i < count; ++i)
+            {
+                out[i] = static_cast<float>(in[i]) * s_int16Scale;
+            }
+        }
+
+        // from sample first onwards, first has to be a multiple of channels
+        void minMaxTail(
+            const float* in, const int channels, const std::size_t first, const std::size_t count, float* min,
+            float* max)
+        {
+            for (std::size_t i{first}; i < count; ++i)
+            {
+                const int c{static_cast<int>(i % static_cast<std::size_t>(channels))};
+                min[c] = std::min(min[c], in[i]);
+                max[c] = std::max(max[c], in[i]);
+            }
+        }
+
+        void minMax(const float* in, const int channels, const std::size_t frames, float* min, float* max)
+        {
+            minMaxTail(in, channels, 0, frames * channels, min, max);
+        }
+    } // namespace scalar
+
+    // vector paths only exist for mono and stereo (and, for minMax, channel counts that divide the vector width)
+#ifdef KERNELS_X86
+    namespace sse2
+    {
+        void deinterleave(const float* in, float* const* out, const int channels, const std::size_t frames)
+        {
+            if (channels == 1)
+            {
+                std::memcpy(out[0], in, frames * sizeof(float));
+                return;
+            }
+            if (channels != 2)
+            {
+                scalar::deinterleave(in, out, channels, frames);
+                return;
+            }
+
+            float* left{out[0]};
+            float* right{out[1]};
+            std::size_t i{0};
+            for (; i + 4 <= frames; i += 4)
+            {
+                const __m128 a{_mm_loadu_ps(in + i * 2)};
+                const __m128 b{_mm_loadu_ps(in + i * 2 + 4)};
+                _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+                _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+            }
+            for (; i < frames; ++i)
+            {
+                left[i] = in[i * 2];
+                right[i] = in[i * 2 + 1];
+            }
+        }
+
+        // sign extends and scales 8 int16 samples
+        inline void toFloat8(const __m128i samples, __m128& low, __m128& high)
+        {
+            const __m128 scale{_mm_set1_ps(s_int16Scale)};
+            low = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16)), scale);
+            high = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16)), scale);
+        }
+
+        void toFloat(const std::int16_t* in, float* out, const std::size_t count)
+        {
+            std::size_t i{0};
+            for (; i + 8 <= count; i += 8)
+            {
+                __m128 low, high;
+                toFloat8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), low, high);
+                _mm_storeu_ps(out + i, low);
+                _mm_storeu_ps(out + i + 4, high);
+            }
+            scalar::toFloat(in + i, out + i, count - i);
+        }
+
+        void deinterleave16(const std::int16_t* in, float* const* out, const int channels, const std::size_t frames)
+        {
+            if (channels == 1)
+            {
+                toFloat(in, out[0], frames);
+                return;
+            }
+            if (channels != 2)
+            {
+                scalar::deinterleave16(in, out, channels, frames);
+                return;
+            }
+
+            float* left{out[0]};
+            float* right{out[1]};
+            std::size_t i{0};
+            for (; i + 4 <= frames; i += 4)
+            {
+                __m128 a, b;
+                toFloat8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2)), a, b);
+                _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+                _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+            }
+            for (; i < frames; ++i)
+            {
+                left[i] = static_cast<float>(in[i * 2]) * s_int16Scale;
+                right[i] = static_cast<float>(in[i * 2 + 1]) * s_int16Scale;
+            }
+        }
+
+        void interleave(const float* const* in, float* out, const int channels, const std::size_t frames)
+        {
+            if (channels == 1)
+            {
+                std::memcpy(out, in[0], frames * sizeof(float));
+                return;
+            }
+            if (channels != 2)
+            {
+                scalar::interleave(in, out, channels, frames);
+                return;
+            }
+
+            const float* left{in[0]};
+            const float* right{in[1]};
+            std::size_t i{0};
+            for (; i + 4 <= frames; i += 4)
+            {
+                const __m128 l{_mm_loadu_ps(left + i)};
+                const __m128 r{_mm_loadu_ps(right + i)};
+                _mm_storeu_ps(out + i * 2, _mm_unpacklo_ps(l, r));
+                _mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(l, r));
+            }
+            for (; i < frames; ++i)
+            {
+                out[i * 2] = left[i];
+                out[i * 2 + 1] = right[i];
+            }
+        }
+
+        void minMax(const float* in, const int channels, const std::size_t frames, float* min, float* max)
+        {
+            if (4 % channels != 0)
+            {
+                scalar::minMax(in, channels, frames, min, max);
+                return;
+            }
+
+            // lane l holds channel l % channels
+            alignas(16) float lowLanes[4];
+            alignas(16) float highLanes[4];
+            for (int l{0}; l < 4; ++l)
+            {
+                lowLanes[l] = min[l % channels];
+                highLanes[l] = max[l % channels];
+            }
+
+            __m128 low{_mm_load_ps(lowLanes)};
+            __m128 high{_mm_load_ps(highLanes)};
+            const std::size_t count{frames * channels};
+            std::size_t i{0};
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m128 samples{_mm_loadu_ps(in + i)};
+                low = _mm_min_ps(low, samples);
+                high = _mm_max_ps(high, samples);
+            }
+
+            _mm_store_ps(lowLanes, low);
+            _mm_store_ps(highLanes, high);
+            for (int l{0}; l < 4; ++l)
+            {
+                min[l % channels] = std::min(min[l % channels], lowLanes[l]);
+                max[l % channels] = std::max(max[l % channels], highLanes[l]);
+            }
+            scalar::minMaxTail(in, channels, i, count, min, max);
+        }
+    } // namespace sse2
+
+    namespace avx2
+    {
+        // interleaved stereo a = frames 0-3, b = frames 4-7
+        KERNELS_AVX2_TARGET inline void split(const __m256 a, const __m256 b, float* left, float* right)
+        {
+            // [L0 L1 L4 L5 | L2 L3 L6 L7] -> in order
+            const __m256 l{_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))};
+            const __m256 r{_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))};
+            _mm256_storeu_ps(
+                left, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(l), _MM_SHUFFLE(3, 1, 2, 0))));
+            _mm256_storeu_ps(
+                right, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0))));
+        }
+
+        KERNELS_AVX2_TARGET inline __m256 toFloat8(const __m128i samples)
+        {
+            return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(samples)), _mm256_set1_ps(s_int16Scale));
+        }
+
+        KERNELS_AVX2_TARGET void deinterleave(
+            const float* in, float* const* out, const int channels, const std::size_t frames)
+        {
+            if (channels != 2)
+            {
+                sse2::deinterleave(in, out, channels, frames);
+                return;
+            }
+
+            std::size_t i{0};
+            for (; i + 8 <= frames; i += 8)
+            {
+                split(_mm256_loadu_ps(in + i * 2), _mm256_loadu_ps(in + i * 2 + 8), out[0] + i, out[1] + i);
+            }
+
+            const std::array<float*, 2> rest{out[0] + i, out[1] + i};
+            sse2::deinterleave(in + i * 2, rest.data(), 2, frames - i);
+        }
+
+        KERNELS_AVX2_TARGET void toFloat(const std::int16_t* in, float* out, const std::size_t count)
+        {
+            std::size_t i{0};
+            for (; i + 8 <= count; i += 8)
+            {
+                _mm256_storeu_ps(out + i, toFloat8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))));
+            }
+            sse2::toFloat(in + i, out + i, count - i);
+        }
+
+        KERNELS_AVX2_TARGET void deinterleave16(
+            const std::int16_t* in, float* const* out, const int channels, const std::size_t frames)
+        {
+            if (channels == 1)
+            {
+                toFloat(in, out[0], frames);
+                return;
+            }
+            if (channels != 2)
+            {
+                scalar::deinterleave16(in, out, channels, frames);
+                return;
+            }
+
+            std::size_t i{0};
+            for (; i + 8 <= frames; i += 8)
+            {
+                const __m256 a{toFloat8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2)))};
+                const __m256 b{toFloat8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2 + 8)))};
+                split(a, b, out[0] + i, out[1] + i);
+            }
+
+            const std::array<float*, 2> rest{out[0] + i, out[1] + i};
+            sse2::deinterleave16(in + i * 2, rest.data(), 2, frames - i);
+        }
+
+        KERNELS_AVX2_TARGET void interleave(
+            const float* const* in, float* out, const int channels, const std::size_t frames)
+        {
+            if (channels != 2)
+            {
+                sse2::interleave(in, out, channels, frames);
+                return;
+            }
+
+            std::size_t i{0};
+            for (; i + 8 <= frames; i += 8)
+            {
+                const __m256 l{_mm256_loadu_ps(in[0] + i)};
+                const __m256 r{_mm256_loadu_ps(in[1] + i)};
+                // [L0 R0 L1 R1 | L4 R4 L5 R5], [L2 R2 L3 R3 | L6 R6 L7 R7]
+                const __m256 low{_mm256_unpacklo_ps(l, r)};
+                const __m256 high{_mm256_unpackhi_ps(l, r)};
+                _mm256_storeu_ps(out + i * 2, _mm256_permute2f128_ps(low, high, 0x20));
+                _mm256_storeu_ps(out + i * 2 + 8, _mm256_permute2f128_ps(low, high, 0x31));
+            }
+
+            const std::array<const float*, 2> rest{in[0] + i, in[1] + i};
+            sse2::interleave(rest.data(), out + i * 2, 2, frames - i);
+        }
+
+        KERNELS_AVX2_TARGET void minMax(
+            const float* in, const int channels, const std::size_t frames, float* min, float* max)
+        {
+            if (8 % channels != 0)
+            {
+                scalar::minMax(in, channels, frames, min, max);
+                return;
+            }
+
+            alignas(32) float lowLanes[8];
+            alignas(32) float highLanes[8];
+            for (int l{0}; l < 8; ++l)
+            {
+                lowLanes[l] = min[l % channels];
+                highLanes[l] = max[l % channels];
+            }
+
+            __m256 low{_mm256_load_ps(lowLanes)};
+            __m256 high{_mm256_load_ps(highLanes)};
+            const std::size_t count{frames * channels};
+            std::size_t i{0};
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m256 samples{_mm256_loadu_ps(in + i)};
+                low = _mm256_min_ps(low, samples);
+                high = _mm256_max_ps(high, samples);
+            }
+
+            _mm256_store_ps(lowLanes, low);
+            _mm256_store_ps(highLanes, high);
+            for (int l{0}; l < 8; ++l)
+            {
+                min[l % channels] = std::min(min[l % channels], lowLanes[l]);
+                max[l % channels] = std::max(max[l % channels], highLanes[l]);
+            }
+            scalar::minMaxTail(in, channels, i, count, min, max);
+        }
+    } // namespace avx2
+
+    bool cpuHasAvx2()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+
+        // the OS has to save the YMM registers too
+        __cpuid(info, 1);
+        const bool osxsave{(info[2] & (1 << 27)) != 0};
+        const bool avx{(info[2] & (1 << 28)) != 0};
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+        {
+            return false;
+        }
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif // KERNELS_X86
+
+#ifdef KERNELS_NEON
+    namespace neon
+    {
+        void deinterleave(const float* in, float* const* out, const int channels, const std::size_t frames)
+        {
+            if (channels == 1)
+            {
+                std::memcpy(out[0], in, frames * sizeof(float));
+                return;
+            }
+            if (channels != 2)
+            {
+                scalar::deinterleave(in, out, channels, frames);
+                return;
+            }
+
+            std::size_t i{0};
+            for (; i + 4 <= frames; i += 4)
+            {
+                const float32x4x2_t samples{vld2q_f32(in + i * 2)};
+                vst1q_f32(out[0] + i, samples.val[0]);
+                vst1q_f32(out[1] + i, samples.val[1]);
+            }
+            for (; i < frames; ++i)
+            {
+                out[0][i] = in[i * 2];
+                out[1][i] = in[i * 2 + 1];
+            }
+        }
+
+        inline float32x4_t toFloat4(const int16x4_t samples)
+        {
+            return vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(samples)), s_int16Scale);
+        }
+
+        void toFloat(const std::int16_t* in, float* out, const std::size_t count)
+        {
+            std::size_t i{0};
+            for (; i + 8 <= count; i += 8)
+            {
+                const int16x8_t samples{vld1q_s16(in + i)};
+                vst1q_f32(out + i, toFloat4(vget_low_s16(samples)));
+                vst1q_f32(out + i + 4, toFloat4(vget_high_s16(samples)));
+            }
+            scalar::toFloat(in + i, out + i, count - i);
+        }
+
+        void deinterleave16(const std::int16_t* in, float* const* out, const int channels, const std::size_t frames)
+        {
+            if (channels == 1)
+            {
+                toFloat(in, out[0], frames);
+                return;
+            }
+            if (channels != 2)
+            {
+                scalar::deinterleave16(in, out, channels, frames);
+                return;
+            }
+
+            std::size_t i{0};
+            for (; i + 8 <= frames; i += 8)
+            {
+                const int16x8x2_t samples{vld2q_s16(in + i * 2)};
+                vst1q_f32(out[0] + i, toFloat4(vget_low_s16(samples.val[0])));
+                vst1q_f32(out[0] + i + 4, toFloat4(vget_high_s16(samples.val[0])));
+                vst1q_f32(out[1] + i, toFloat4(vget_low_s16(samples.val[1])));
+                vst1q_f32(out[1] + i + 4, toFloat4(vget_high_s16(samples.val[1])));
+            }
+            for (; i < frames; ++i)
+            {
+                out[0][i] = static_cast<float>(in[i * 2]) * s_int16Scale;
+                out[1][i] = static_cast<float>(in[i * 2 + 1]) * s_int16Scale;
+            }
+        }
+
+        void interleave(const float* const* in, float* out, const int channels, const std::size_t frames)
+        {
+            if (channels == 1)
+            {
+                std::memcpy(out, in[0], frames * sizeof(float));
+                return;
+            }
+            if (channels != 2)
+            {
+                scalar::interleave(in, out, channels, frames);
+                return;
+            }
+
+            std::size_t i{0};
+            for (; i + 4 <= frames; i += 4)
+            {
+                vst2q_f32(out + i * 2, float32x4x2_t{{vld1q_f32(in[0] + i), vld1q_f32(in[1] + i)}});
+            }
+            for (; i < frames; ++i)
+            {
+                out[i * 2] = in[0][i];
+                out[i * 2 + 1] = in[1][i];
+            }
+        }
+
+        void minMax(const float* in, const int channels, const std::size_t frames, float* min, float* max)
+        {
+            if (4 % channels != 0)
+            {
+                scalar::minMax(in, channels, frames, min, max);
+                return;
+            }
+
+            float lowLanes[4];
+            float highLanes[4];
+            for (int l{0}; l < 4; ++l)
+            {
+                lowLanes[l] = min[l % channels];
+                highLanes[l] = max[l % channels];
+            }
+
+            float32x4_t low{vld1q_f32(lowLanes)};
+            float32x4_t high{vld1q_f32(highLanes)};
+            const std::size_t count{frames * channels};
+            std::size_t i{0};
+            for (; i + 4 <= count; i += 4)
+            {
+                const float32x4_t samples{vld1q_f32(in + i)};
+                low = vminq_f32(low, samples);
+                high = vmaxq_f32(high, samples);
+            }
+
+            vst1q_f32(lowLanes, low);
+            vst1q_f32(highLanes, high);
+            for (int l{0}; l < 4; ++l)
+            {
+                min[l % channels] = std::min(min[l % channels], lowLanes[l]);
+                max[l % channels] = std::max(max[l % channels], highLanes[l]);
+            }
+            scalar::minMaxTail(in, channels, i, count, min, max);
+        }
+    } // namespace neon
+#endif // KERNELS_NEON
+
+    constexpr Table s_scalar{
+        Kernels::Isa::Scalar,
+        scalar::deinterleave,
+        scalar::deinterleave16,
+        scalar::interleave,
+        scalar::toFloat,
+        scalar::minMax};
+
+#ifdef KERNELS_X86
+    constexpr Table s_sse2{
+        Kernels::Isa::SSE2, sse2::deinterleave, sse2::deinterleave16, sse2::interleave, sse2::toFloat, sse2::minMax};
+    constexpr Table s_avx2{
+        Kernels::Isa::AVX2, avx2::deinterleave, avx2::deinterleave16, avx2::interleave, avx2::toFloat, avx2::minMax};
+#endif
+
+#ifdef KERNELS_NEON
+    constexpr Table s_neon{
+        Kernels::Isa::NEON, neon::deinterleave, neon::deinterleave16, neon::interleave, neon::toFloat, neon::minMax};
+#endif
+
+    const Table* tableFor(const Kernels::Isa isa)
+    {
+        switch (isa)
+        {
+        case Kernels::Isa::Scalar:
+            return &s_scalar;
+#ifdef KERNELS_X86
+        case Kernels::Isa::SSE2:
+            return &s_sse2;
+        case Kernels::Isa::AVX2:
+            return cpuHasAvx2() ? &s_avx2 : nullptr;
+#endif
+#ifdef KERNELS_NEON
+        case Kernels::Isa::NEON:
+            return &s_neon;
+#endif
+        default:
+            return nullptr;
+        }
+    }
+
+    const Table* bestTable()
+    {
+        for (const Kernels::Isa isa : {Kernels::Isa::AVX2, Kernels::Isa::NEON, Kernels::Isa::SSE2})
+        {
+            if (const Table* table{tableFor(isa)})
+            {
+                return table;
+            }
+        }
+        return &s_scalar;
+    }
+
+    // picked before main() so the audio thread never pays for the CPU check
+    std::atomic<const Table*> s_table{bestTable()};
+
+    [[nodiscard]] inline const Table& table() { return *s_table.load(std::memory_order_relaxed); }
+} // namespace
+
+Kernels::Isa Kernels::isa() { return table().isa; }
+
+const char* Kernels::isaName(const Isa isa)
+{
+    switch (isa)
+    {
+    case Isa::SSE2:
+        return "SSE2";
+    case Isa::AVX2:
+        return "AVX2";
+    case Isa::NEON:
+        return "NEON";
+    default:
+        return "scalar";
+    }
+}
+
+bool Kernels::supported(const Isa isa) { return tableFor(isa) != nullptr; }
+
+bool Kernels::setIsa(const Isa isa)
+{
+    const Table* table{tableFor(isa)};
+    if (!table)
+    {
+        return false;
+    }
+
+    s_table.store(table);
+    return true;
+}
+
+void Kernels::deinterleave(const float* in, float* const* out, const int channels, const std::size_t frames)
+{
+    table().deinterleave(in, out, channels, frames);
+}
+
+void Kernels::deinterleave(const std::int16_t* in, float* const* out, const int channels, const std::size_t frames)
+{
+    table().deinterleave16(in, out, channels, frames);
+}
+
+void Kernels::interleave(const float* const* in, float* out, const int channels, const std::size_t frames)
+{
+    table().interleave(in, out, channels, frames);
+}
+
+void Kernels::toFloat(const std::int16_t* in, float* out, const std::size_t count) { table().toFloat(in, out, count); }
+
+// libc already picks the widest stores the CPU has at runtime
+void Kernels::zero(float* out, const std::size_t count) { std::memset(out, 0, count * sizeof(float)); }
+
+void Kernels::minMax(const float* in, const int channels, const std::size_t frames, float* min, float* max)
+{
+    table().minMax(in, channels, frames, min, max);
+}
@@ -0,0 +1,61 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_KERNELS_H
+#define SPEEDSHIFTER_KERNELS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// Vectorised sample loops used on the audio path.
+// The widest instruction set the CPU supports is picked once at startup (AVX2 or SSE2 on x86, NEON on ARM),
+// everything falls back to plain loops elsewhere or for channel counts without a vector path.
+// All functions are real-time safe: no allocations, no locks.
+namespace Kernels
+{
+    enum class Isa
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+        NEON
+    };
+
+    // instruction set currently in use
+    [[nodiscard]] Isa isa();
+    [[nodiscard]] const char* isaName(Isa isa);
+    [[nodiscard]] bool supported(Isa isa);
+    // switches every kernel over to isa (for benchmarks), returns false if the CPU doesn't support it
+    bool setIsa(Isa isa);
+
+    // interleaved [frames * channels] -> out[channels][frames]
+    void deinterleave(const float* in, float* const* out, int channels, std::size_t frames);
+    // same, int16 samples are scaled to -1..1
+    void deinterleave(const std::int16_t* in, float* const* out, int channels, std::size_t frames);
+    // in[channels][frames] -> interleaved [frames * channels]
+    void interleave(const float* const* in, float* out, int channels, std::size_t frames);
+
+    void toFloat(const std::int16_t* in, float* out, std::size_t count);
+    void zero(float* out, std::size_t count);
+
+    // widens min[c] / max[c] to the extremes of each channel in interleaved [frames * channels]
+    void minMax(const float* in, int channels, std::size_t frames, float* min, float* max);
+
+    // full scale of an int16 sample, every conversion to and from float goes through it
+    inline constexpr float s_int16Max{32767.0f};
+
+    // clamped to -1..1 and rounded to the nearest step
+    [[nodiscard]] inline std::int16_t toInt16(const float sample)
+    {
+        const float scaled{std::clamp(sample, -1.0f, 1.0f) * s_int16Max};
+        return static_cast<std::int16_t>(scaled >= 0.0f ? scaled + 0.5f : scaled - 0.5f);
+    }
+
+    // a single sample, same as the vectorised toFloat() above
+    [[nodiscard]] inline float toFloat(const std::int16_t sample)
+    {
+        return static_cast<float>(sample) * (1.0f / s_int16Max);
+    }
+} // namespace Kernels
+
+#endif // SPEEDSHIFTER_KERNELS_H
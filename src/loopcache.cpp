@@ -0,0 +1,304 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#include "loopcache.h"
+#include "render.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <unordered_set>
+
+namespace
+{
+    // rendered ahead of a segment's start and thrown away, the stretcher starts from silence (see Render::stretch())
+    constexpr double s_preRollSeconds{0.5};
+
+    // output frame that source frame falls on at speed, the same for every segment that starts or ends there
+    std::size_t outputFrame(const std::size_t source, const float speed)
+    {
+        return static_cast<std::size_t>(std::llround(static_cast<double>(source) / speed));
+    }
+} // namespace
+
+void LoopCache::Loop::read(std::size_t frame, std::size_t count, float* const* out, std::size_t outOffset) const
+{
+    std::size_t s{static_cast<std::size_t>(std::upper_bound(offsets.begin(), offsets.end(), frame) - offsets.begin())};
+    s = s > 0 ? s - 1 : 0;
+
+    while (count > 0 && s < segments.size())
+    {
+        const Segment& segment{*segments[s]};
+        // the first segment fades in from the last one's tail, that's the wrap
+        const Segment& previous{*segments[s > 0 ? s - 1 : segments.size() - 1]};
+        const std::size_t local{frame - offsets[s]};
+        const std::size_t length{std::min(count, segment.frames - local)};
+        const std::size_t fade{std::min(fadeIn.size(), segment.frames)};
+        const std::size_t faded{local < fade ? std::min(fade - local, length) : 0};
+
+        for (std::size_t c{0}; c < segment.audio.size(); ++c)
+        {
+            const float* body{segment.audio[c].data() + local};
+            const float* tail{previous.audio[c].data() + previous.frames + local};
+            float* dest{out[c] + outOffset};
+            for (std::size_t f{0}; f < faded; ++f)
+            {
+                const float gain{fadeIn[local + f]};
+                dest[f] = tail[f] * (1.0f - gain) + body[f] * gain;
+            }
+            std::memcpy(dest + faded, body + faded, (length - faded) * sizeof(float));
+        }
+
+        frame += length;
+        outOffset += length;
+        count -= length;
+        ++s;
+    }
+}
+
+std::size_t LoopCache::bytes(const std::size_t start, const std::size_t end, const float speed, const int channels)
+{
+    return Render::outputFrames(end > start ? end - start : 0, speed) * static_cast<std::size_t>(channels) *
+           sizeof(float);
+}
+
+std::shared_ptr<const LoopCache::Loop> LoopCache::render(
+    const SampleStore& store,
+    const int sampleRate,
+    const int channels,
+    const std::size_t start,
+    const std::size_t end,
+    const float speed,
+    const std::atomic<bool>& running)
+{
+    if (end <= start || end > store.frames() || bytes(start, end, speed, channels) > LOOP_CACHE_BYTES)
+    {
+        return nullptr;
+    }
+
+    // cut on the grid, but never so close to A or B that a segment is shorter than a crossfade
+    const std::size_t grid{static_cast<std::size_t>(s_segmentSeconds * sampleRate)};
+    const std::size_t margin{minimumFrames(sampleRate, speed)};
+    std::vector<std::size_t> bounds{start};
+    for (std::size_t line{(start + margin + grid - 1) / grid * grid}; line + margin <= end; line += grid)
+    {
+        bounds.push_back(line);
+    }
+    bounds.push_back(end);
+
+    const std::size_t count{bounds.size() - 1};
+    std::vector<std::shared_ptr<const Segment>> segments(count);
+    std::vector<std::size_t> missing{};
+    {
+        std::lock_guard lock{m_mutex};
+        for (std::size_t s{0}; s < count; ++s)
+        {
+            segments[s] = findSegment(bounds[s], bounds[s + 1], speed);
+            if (!segments[s])
+            {
+                missing.push_back(s);
+            }
+        }
+    }
+
+    // a segment per core at a time, each stretched on one
+    std::atomic<std::size_t> next{0};
+    const auto renderMissing{[&]()
+    {
+        for (std::size_t i{next++}; i < missing.size() && running.load(); i = next++)
+        {
+            const std::size_t s{missing[i]};
+            segments[s] = renderSegment(store, sampleRate, channels, bounds[s], bounds[s + 1], speed, running);
+        }
+    }};
+    const std::size_t threads{
+        std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, std::max<std::size_t>(missing.size(), 1))};
+    std::vector<std::thread> workers{};
+    for (std::size_t t{1}; t < threads; ++t)
+    {
+        workers.emplace_back(renderMissing);
+    }
+    renderMissing();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    if (!running.load() || std::any_of(segments.begin(), segments.end(), [](const auto& segment) { return !segment; }))
+    {
+        return nullptr;
+    }
+
+    const std::shared_ptr<Loop> loop{std::make_shared<Loop>()};
+    loop->start = start;
+    loop->end = end;
+    loop->speed = speed;
+    loop->segments = std::move(segments);
+    for (const std::shared_ptr<const Segment>& segment : loop->segments)
+    {
+        loop->offsets.push_back(loop->length);
+        loop->length += segment->frames;
+    }
+
+    const std::size_t crossfade{std::max(static_cast<std::size_t>(s_crossfadeSeconds * sampleRate), std::size_t{1})};
+    loop->fadeIn.resize(crossfade);
+    for (std::size_t f{0}; f < crossfade; ++f)
+    {
+        const float angle{(static_cast<float>(f) + 0.5f) / static_cast<float>(crossfade) * 1.5707964f};
+        loop->fadeIn[f] = std::sin(angle) * std::sin(angle);
+    }
+    return loop;
+}
+
+std::shared_ptr<const LoopCache::Segment> LoopCache::renderSegment(
+    const SampleStore& store,
+    const int sampleRate,
+    const int channels,
+    const std::size_t start,
+    const std::size_t end,
+    const float speed,
+    const std::atomic<bool>& running)
+{
+    // all in output frames, except where it says source
+    const std::size_t crossfade{std::max(static_cast<std::size_t>(s_crossfadeSeconds * sampleRate), std::size_t{1})};
+    const std::size_t frames{std::max(outputFrame(end, speed) - outputFrame(start, speed), std::size_t{1})};
+    const std::size_t preRollSource{std::min(start, static_cast<std::size_t>(s_preRollSeconds * sampleRate))};
+    const std::size_t preRoll{outputFrame(preRollSource, speed)};
+    // what comes after the end, faded into whatever follows
+    const std::size_t tailSource{static_cast<std::size_t>(std::ceil(static_cast<double>(crossfade) * speed)) + 1};
+
+    // just the part of the file we need, read straight into a store of its own
+    const std::size_t from{start - preRollSource};
+    const std::size_t to{std::min(end + tailSource, store.frames())};
+    const std::shared_ptr<SampleStore> range{SampleStore::create(SampleStore::Format::Float, store.channels())};
+    for (std::size_t frame{from}; frame < to;)
+    {
+        std::size_t space;
+        float* dest{static_cast<float*>(range->beginWrite(space))};
+        const std::size_t read{dest ? store.readInterleaved(frame, std::min(space, to - frame), dest) : 0};
+        if (read == 0)
+        {
+            break;
+        }
+        range->endWrite(read);
+        frame += read;
+    }
+    range->finish();
+
+    // the stretched audio goes straight to where it's played from, in the device's channel layout
+    // (a tail past the end of the file stays silent)
+    const std::shared_ptr<Segment> segment{std::make_shared<Segment>()};
+    segment->start = start;
+    segment->end = end;
+    segment->speed = speed;
+    segment->frames = frames;
+    segment->audio.resize(channels);
+    for (int c{0}; c < channels; ++c)
+    {
+        segment->audio[c].resize(frames + crossfade);
+    }
+
+    const int rangeChannels{range->channels()};
+    std::size_t produced{0};
+    Render::Settings settings{};
+    settings.speed = speed;
+    // the segments are already spread over the cores
+    settings.threads = 1;
+    const bool complete{Render::stretch(
+        *range,
+        sampleRate,
+        settings,
+        [&](const float* audio, const std::size_t count)
+        {
+            for (std::size_t f{0}; f < count; ++f, ++produced)
+            {
+                if (produced < preRoll || produced >= preRoll + frames + crossfade)
+                {
+                    continue;
+                }
+
+                for (int c{0}; c < channels; ++c)
+                {
+                    // mono goes to every channel, channels the source doesn't have stay silent
+                    const int source{rangeChannels == 1 ? 0 : c};
+                    segment->audio[c][produced - preRoll] =
+                        source < rangeChannels ? audio[f * rangeChannels + source] : 0.0f;
+                }
+            }
+            return true;
+        },
+        running)};
+    return complete ? segment : nullptr;
+}
+
+std::size_t LoopCache::minimumFrames(const int sampleRate, const float speed)
+{
+    return static_cast<std::size_t>(2.0 * s_crossfadeSeconds * sampleRate * speed) + 1;
+}
+
+std::shared_ptr<const LoopCache::Loop> LoopCache::find(
+    const std::size_t start,
+    const std::size_t end,
+    const float speed)
+{
+    std::lock_guard lock{m_mutex};
+    for (auto it{m_loops.begin()}; it != m_loops.end(); ++it)
+    {
+        if ((*it)->start == start && (*it)->end == end && (*it)->speed == speed)
+        {
+            m_loops.splice(m_loops.begin(), m_loops, it);
+            return m_loops.front();
+        }
+    }
+    return nullptr;
+}
+
+void LoopCache::insert(std::shared_ptr<const Loop> loop)
+{
+    std::lock_guard lock{m_mutex};
+    m_loops.push_front(std::move(loop));
+    while (m_loops.size() > 1 && usage() > LOOP_CACHE_BYTES)
+    {
+        m_loops.pop_back();
+    }
+}
+
+void LoopCache::clear()
+{
+    std::lock_guard lock{m_mutex};
+    m_loops.clear();
+}
+
+std::shared_ptr<const LoopCache::Segment> LoopCache::findSegment(
+    const std::size_t start,
+    const std::size_t end,
+    const float speed) const
+{
+    for (const std::shared_ptr<const Loop>& loop : m_loops)
+    {
+        for (const std::shared_ptr<const Segment>& segment : loop->segments)
+        {
+            if (segment->start == start && segment->end == end && segment->speed == speed)
+            {
+                return segment;
+            }
+        }
+    }
+    return nullptr;
+}
+
+std::size_t LoopCache::usage() const
+{
+    std::unordered_set<const Segment*> counted{};
+    std::size_t bytes{0};
+    for (const std::shared_ptr<const Loop>& loop : m_loops)
+    {
+        for (const std::shared_ptr<const Segment>& segment : loop->segments)
+        {
+            if (counted.insert(segment.get()).second)
+            {
+                bytes += segment->bytes();
+            }
+        }
+    }
+    return bytes;
+}
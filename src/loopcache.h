@@ -0,0 +1,105 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_LOOPCACHE_H
+#define SPEEDSHIFTER_LOOPCACHE_H
+
+#include "samplestore.h"
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Max size of the rendered loops kept around, longer loops are only ever stretched live
+#define LOOP_CACHE_BYTES (256ll * 1024 * 1024)
+
+// Stretched A-B loops, rendered once in the background so the worker can replay them instead of stretching the
+// same passage over and over. The audio that follows a loop's end is crossfaded into its start, so playing it
+// from the last frame straight back to the first one sounds like the passage simply continues.
+// Loops are cut into segments on a fixed grid of source frames, which are rendered in parallel and shared between
+// loops. Moving A or B only renders the segments at the ends again, everything in between is taken from the loops
+// rendered before.
+class LoopCache
+{
+public:
+    // length of the crossfades at the wrap and between segments, in seconds
+    static constexpr double s_crossfadeSeconds{0.05};
+    // source grid the segments are cut on
+    static constexpr double s_segmentSeconds{10.0};
+
+    // [start, end) of the source at speed, followed by what comes after end for the crossfade into the next one
+    struct Segment
+    {
+        std::size_t start{0}; // in source frames
+        std::size_t end{0};
+        float speed{1.0f};
+        std::size_t frames{0}; // output, without the tail
+        // frames + crossfade frames per device channel
+        std::vector<std::vector<float>> audio{};
+
+        [[nodiscard]] std::size_t bytes() const { return audio.size() * audio[0].size() * sizeof(float); }
+    };
+
+    struct Loop
+    {
+        std::size_t start{0}; // in source frames, [start, end)
+        std::size_t end{0};
+        float speed{1.0f};
+        // output frame f plays source frame start + f * speed
+        std::vector<std::shared_ptr<const Segment>> segments{};
+        std::vector<std::size_t> offsets{}; // output frame every segment starts at
+        std::size_t length{0};
+        // gain of the segment being faded in, one per crossfade frame
+        std::vector<float> fadeIn{};
+
+        [[nodiscard]] std::size_t frames() const { return length; }
+        // count frames from frame on (without wrapping) into out[c] + outOffset, real-time safe
+        void read(std::size_t frame, std::size_t count, float* const* out, std::size_t outOffset) const;
+    };
+
+    // what rendering start..end at speed in channels takes, roughly
+    [[nodiscard]] static std::size_t bytes(std::size_t start, std::size_t end, float speed, int channels);
+
+    // start..end of a finished store at speed in the device's channels, null if running was cleared first or it
+    // wouldn't fit in LOOP_CACHE_BYTES
+    [[nodiscard]] std::shared_ptr<const Loop> render(
+        const SampleStore& store,
+        int sampleRate,
+        int channels,
+        std::size_t start,
+        std::size_t end,
+        float speed,
+        const std::atomic<bool>& running);
+
+    // shortest loop that leaves room for the crossfade, in source frames
+    [[nodiscard]] static std::size_t minimumFrames(int sampleRate, float speed);
+
+    // null if it hasn't been rendered (yet)
+    [[nodiscard]] std::shared_ptr<const Loop> find(std::size_t start, std::size_t end, float speed);
+    // drops least recently used renders until the rest fit in LOOP_CACHE_BYTES, kept so going back to an earlier
+    // range or speed is instant
+    void insert(std::shared_ptr<const Loop> loop);
+    void clear();
+
+private:
+    [[nodiscard]] static std::shared_ptr<const Segment> renderSegment(
+        const SampleStore& store,
+        int sampleRate,
+        int channels,
+        std::size_t start,
+        std::size_t end,
+        float speed,
+        const std::atomic<bool>& running);
+
+    // with m_mutex held: a segment of a cached loop, null if there is none
+    [[nodiscard]] std::shared_ptr<const Segment> findSegment(std::size_t start, std::size_t end, float speed) const;
+    // with m_mutex held: bytes of every segment the cached loops hold, shared ones counted once
+    [[nodiscard]] std::size_t usage() const;
+
+    std::mutex m_mutex{};
+    std::list<std::shared_ptr<const Loop>> m_loops{}; // most recently used first
+};
+
+#endif // SPEEDSHIFTER_LOOPCACHE_H
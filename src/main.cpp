@@ -6,6 +6,8 @@
 int main(int argc, char* argv[])
 {
     qputenv("QT_QUICK_CONTROLS_STYLE", "Fusion");
+    // also names the cache directory
+    QCoreApplication::setApplicationName("speedshifter");
     QGuiApplication app(argc, argv);
     QGuiApplication::setWindowIcon(QIcon(":/icon.png"));
 
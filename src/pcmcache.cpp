@@ -0,0 +1,258 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#include "pcmcache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    constexpr char s_magic[8]{'S', 'S', 'P', 'C', 'M', '\0', '\0', '\0'};
+    constexpr std::uint32_t s_version{3};
+    // keeps the PCM data page aligned inside the mapping
+    constexpr std::uint64_t s_alignment{4096};
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t sampleRate;
+        std::uint32_t channels;
+        std::uint32_t sampleFormat; // SampleStore::Format, Float or Int16
+        std::uint32_t peakFrames; // frames per base level peak
+        std::int64_t sourceSize;
+        std::int64_t sourceModified; // ms since epoch
+        std::uint64_t frames;
+        std::uint64_t peakCount;
+        std::uint64_t peakOffset;
+        std::uint64_t pcmOffset;
+    };
+
+    // keeps the cache file open (and mapped) for as long as a store points into it
+    struct Mapping
+    {
+        QFile file;
+        uchar* data{nullptr};
+
+        ~Mapping()
+        {
+            if (data)
+            {
+                file.unmap(data);
+            }
+        }
+    };
+
+    QString cacheDirectory() { return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/pcm"; }
+
+    QString cachePath(const QFileInfo& source, const int sampleRate, const int channels)
+    {
+        const QString key{QString{"%1|%2|%3|%4|%5"}
+                              .arg(source.absoluteFilePath())
+                              .arg(source.size())
+                              .arg(source.lastModified().toMSecsSinceEpoch())
+                              .arg(sampleRate)
+                              .arg(channels)};
+        const QByteArray hash{QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex()};
+        return cacheDirectory() + "/" + QString::fromLatin1(hash) + ".pcm";
+    }
+
+    // bytes per sample of a cached format, 0 for the ones that can't be mapped
+    std::uint64_t sampleBytes(const std::uint32_t format)
+    {
+        switch (static_cast<SampleStore::Format>(format))
+        {
+            case SampleStore::Format::Float:
+                return sizeof(float);
+            case SampleStore::Format::Int16:
+                return sizeof(std::int16_t);
+            default:
+                return 0;
+        }
+    }
+} // namespace
+
+std::optional<PCMCache::Entry> PCMCache::load(const QString& sourcePath, const int sampleRate, const int maxChannels)
+{
+    const QFileInfo source{sourcePath};
+    if (!source.exists())
+    {
+        return std::nullopt;
+    }
+
+    const std::shared_ptr<Mapping> mapping{std::make_shared<Mapping>()};
+    mapping->file.setFileName(cachePath(source, sampleRate, maxChannels));
+    if (!mapping->file.exists() || !mapping->file.open(QIODevice::ReadOnly))
+    {
+        return std::nullopt;
+    }
+
+    const std::uint64_t size{static_cast<std::uint64_t>(mapping->file.size())};
+    if (size >= sizeof(Header))
+    {
+        mapping->data = mapping->file.map(0, static_cast<qint64>(size));
+    }
+
+    Header header{};
+    if (mapping->data)
+    {
+        std::memcpy(&header, mapping->data, sizeof(Header));
+    }
+
+    // sizes are checked by dividing what the file has room for, a corrupt header can't make them overflow
+    const std::uint64_t frameBytes{header.channels * sampleBytes(header.sampleFormat)};
+    const bool valid{
+        mapping->data && std::memcmp(header.magic, s_magic, sizeof(s_magic)) == 0 && header.version == s_version &&
+        header.sampleRate == static_cast<std::uint32_t>(sampleRate) &&
+        header.channels > 0 && header.channels <= static_cast<std::uint32_t>(maxChannels) && frameBytes > 0 &&
+        header.peakFrames >= PeakPyramid::s_baseFrames && header.peakFrames % PeakPyramid::s_baseFrames == 0 &&
+        header.sourceSize == source.size() &&
+        header.sourceModified == source.lastModified().toMSecsSinceEpoch() &&
+        header.pcmOffset % s_alignment == 0 && header.pcmOffset <= size &&
+        header.frames <= (size - header.pcmOffset) / frameBytes &&
+        header.peakCount == (header.frames + header.peakFrames - 1) / header.peakFrames * header.channels &&
+        header.peakOffset <= size && header.peakCount <= (size - header.peakOffset) / sizeof(PeakPyramid::Peak)};
+
+    if (!valid)
+    {
+        qWarning() << "Discarding invalid PCM cache entry for `" << sourcePath << "`";
+        if (mapping->data)
+        {
+            mapping->file.unmap(mapping->data);
+            mapping->data = nullptr;
+        }
+        mapping->file.remove();
+        return std::nullopt;
+    }
+
+    // most recently used files survive eviction
+    mapping->file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+
+    std::vector<PeakPyramid::Peak> peaks(header.peakCount);
+    std::memcpy(peaks.data(), mapping->data + header.peakOffset, header.peakCount * sizeof(PeakPyramid::Peak));
+    const uchar* pcm{mapping->data + header.pcmOffset};
+    const int channels{static_cast<int>(header.channels)};
+    const std::size_t frames{static_cast<std::size_t>(header.frames)};
+
+    Entry entry{};
+    entry.peaks = std::make_shared<PeakPyramid>(channels, header.peakFrames);
+    entry.peaks->assign(std::move(peaks), frames);
+    if (static_cast<SampleStore::Format>(header.sampleFormat) == SampleStore::Format::Float)
+    {
+        entry.store = std::make_shared<InterleavedStore<float>>(
+            channels, reinterpret_cast<const float*>(pcm), frames, mapping);
+    }
+    else
+    {
+        entry.store = std::make_shared<InterleavedStore<std::int16_t>>(
+            channels, reinterpret_cast<const std::int16_t*>(pcm), frames, mapping);
+    }
+    return entry;
+}
+
+bool PCMCache::store(
+    const QString& sourcePath,
+    const SampleStore& store,
+    const int sampleRate,
+    const int maxChannels,
+    const PeakPyramid& peaks,
+    const std::atomic<bool>& running)
+{
+    const QFileInfo source{sourcePath};
+    if (!source.exists() || !store.finished() || peaks.frames() != store.frames() || !QDir{}.mkpath(cacheDirectory()))
+    {
+        return false;
+    }
+
+    const std::vector<PeakPyramid::Peak> base{peaks.baseLevel()};
+
+    Header header{};
+    std::memcpy(header.magic, s_magic, sizeof(s_magic));
+    header.version = s_version;
+    header.sampleRate = static_cast<std::uint32_t>(sampleRate);
+    header.channels = static_cast<std::uint32_t>(store.channels());
+    header.sampleFormat =
+        static_cast<std::uint32_t>(store.floatSamples() ? SampleStore::Format::Float : SampleStore::Format::Int16);
+    header.peakFrames = static_cast<std::uint32_t>(peaks.baseFrames());
+    header.sourceSize = source.size();
+    header.sourceModified = source.lastModified().toMSecsSinceEpoch();
+    header.frames = store.frames();
+    header.peakCount = base.size();
+    header.peakOffset = sizeof(Header);
+    header.pcmOffset =
+        (header.peakOffset + header.peakCount * sizeof(PeakPyramid::Peak) + s_alignment - 1) / s_alignment * s_alignment;
+
+    // QSaveFile only replaces the entry once everything has been written
+    QSaveFile file{cachePath(source, sampleRate, maxChannels)};
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    file.write(
+        reinterpret_cast<const char*>(base.data()), static_cast<qint64>(base.size() * sizeof(PeakPyramid::Peak)));
+    file.write(QByteArray(static_cast<qsizetype>(header.pcmOffset) - file.pos(), '\0'));
+
+    // in the store's own sample type
+    constexpr std::size_t stepFrames{1 << 16};
+    const std::size_t frameBytes{store.channels() * sampleBytes(header.sampleFormat)};
+    std::vector<std::uint8_t> scratch(stepFrames * frameBytes);
+
+    std::size_t frame{0};
+    while (frame < header.frames)
+    {
+        if (!running.load())
+        {
+            file.cancelWriting();
+            break;
+        }
+
+        const std::size_t frames{store.readNative(frame, stepFrames, scratch.data())};
+        if (frames == 0)
+        {
+            break;
+        }
+
+        file.write(reinterpret_cast<const char*>(scratch.data()), static_cast<qint64>(frames * frameBytes));
+        frame += frames;
+    }
+
+    return file.commit();
+}
+
+void PCMCache::evict(const qint64 maxBytes)
+{
+    // oldest first
+    const QFileInfoList files{
+        QDir{cacheDirectory()}.entryInfoList({"*.pcm"}, QDir::Files, QDir::Time | QDir::Reversed)};
+
+    qint64 total{0};
+    for (const QFileInfo& file : files)
+    {
+        total += file.size();
+    }
+
+    for (const QFileInfo& file : files)
+    {
+        if (total <= maxBytes)
+        {
+            break;
+        }
+
+        if (QFile::remove(file.absoluteFilePath()))
+        {
+            total -= file.size();
+        }
+    }
+}
@@ -0,0 +1,52 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_PCMCACHE_H
+#define SPEEDSHIFTER_PCMCACHE_H
+
+#include <QString>
+
+#include "peakpyramid.h"
+#include "samplestore.h"
+
+#include <atomic>
+#include <memory>
+#include <optional>
+
+// Max size of all cached files together (least recently used files are evicted first)
+#define PCM_CACHE_MAX_BYTES (4ll * 1024 * 1024 * 1024)
+
+// Persistent cache of decoded, device-rate PCM and its waveform peaks.
+// Entries are keyed by source path, size and modification time, and are memory mapped on reopen
+// so nothing is resident until the playback path touches it.
+//
+// File layout (version 3, native endianness):
+//   Header | PeakPyramid::Peak peaks[peakCount] (base level) | padding to 4 KiB | pcm[frames * channels] (interleaved)
+// Samples are cached in the source's channel layout as the store holds them: float for Float stores, int16 for the
+// 16-bit ones (Packed included, it is mapped back as a plain Int16 store). Reopening gives a store of that type.
+namespace PCMCache
+{
+    struct Entry
+    {
+        std::shared_ptr<SampleStore> store{};
+        std::shared_ptr<PeakPyramid> peaks{};
+    };
+
+    // maps a cached entry for sourcePath, or nothing if there is no valid one
+    // (maxChannels is the channel count the source was limited to when it was decoded)
+    [[nodiscard]] std::optional<Entry> load(const QString& sourcePath, int sampleRate, int maxChannels);
+
+    // writes a fully decoded store to the cache, returns false on failure
+    // (writing stops early once running is cleared)
+    bool store(
+        const QString& sourcePath,
+        const SampleStore& store,
+        int sampleRate,
+        int maxChannels,
+        const PeakPyramid& peaks,
+        const std::atomic<bool>& running);
+
+    // deletes least recently used entries until the cache fits in maxBytes
+    void evict(qint64 maxBytes);
+} // namespace PCMCache
+
+#endif // SPEEDSHIFTER_PCMCACHE_H
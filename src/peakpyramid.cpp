@@ -0,0 +1,258 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#include "peakpyramid.h"
+#include "kernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace
+{
+    // read from the store at once (at least a bucket)
+    constexpr std::size_t s_scanFrames{1 << 14};
+    // below this it isn't worth starting another thread
+    constexpr std::size_t s_minBucketsPerThread{1024};
+} // namespace
+
+PeakPyramid::PeakPyramid(const int channels, const std::size_t baseFrames) :
+    m_channels{channels}, m_baseFrames{baseFrames}, m_levels(1)
+{
+}
+
+std::size_t PeakPyramid::baseFramesFor(const std::size_t frames, const int channels, const std::size_t maxBytes)
+{
+    std::size_t baseFrames{s_baseFrames};
+    while ((frames / baseFrames + 1) * static_cast<std::size_t>(channels) * sizeof(Peak) * 4 / 3 > maxBytes)
+    {
+        baseFrames *= s_factor;
+    }
+    return baseFrames;
+}
+
+std::size_t PeakPyramid::frames() const
+{
+    std::lock_guard lock{m_mutex};
+    return m_frames;
+}
+
+int PeakPyramid::levels() const
+{
+    std::lock_guard lock{m_mutex};
+    return static_cast<int>(m_levels.size());
+}
+
+void PeakPyramid::build(const SampleStore& store)
+{
+    // only this thread changes m_frames, a partial last bucket is simply computed again
+    const std::size_t firstBucket{frames() / m_baseFrames};
+    const std::size_t start{firstBucket * m_baseFrames};
+
+    std::size_t end{store.frames()};
+    if (!store.finished())
+    {
+        end -= end % m_baseFrames;
+    }
+
+    if (end <= start)
+    {
+        return;
+    }
+
+    const std::size_t buckets{(end - start + m_baseFrames - 1) / m_baseFrames};
+    std::vector<Peak> peaks(buckets * m_channels);
+
+    const std::size_t scanBuckets{std::max<std::size_t>(s_scanFrames / m_baseFrames, 1)};
+    const auto scan{[&](const std::size_t from, const std::size_t to)
+    {
+        std::vector<float> scratch(scanBuckets * m_baseFrames * m_channels);
+        for (std::size_t bucket{from}; bucket < to; bucket += scanBuckets)
+        {
+            const std::size_t count{std::min(scanBuckets, to - bucket)};
+            const std::size_t frame{start + bucket * m_baseFrames};
+            const std::size_t read{
+                store.readInterleaved(frame, std::min(count * m_baseFrames, end - frame), scratch.data())};
+
+            for (std::size_t i{0}; i < count; ++i)
+            {
+                const std::size_t first{std::min(i * m_baseFrames, read)};
+                const std::size_t last{std::min(first + m_baseFrames, read)};
+
+                std::array<float, SampleStore::s_maxChannels> low{};
+                std::array<float, SampleStore::s_maxChannels> high{};
+                Kernels::minMax(
+                    scratch.data() + first * m_channels, m_channels, last - first, low.data(), high.data());
+                for (int c{0}; c < m_channels; ++c)
+                {
+                    peaks[(bucket + i) * m_channels + c] = Peak{Kernels::toInt16(low[c]), Kernels::toInt16(high[c])};
+                }
+            }
+        }
+    }};
+
+    const std::size_t threads{std::clamp<std::size_t>(
+        buckets / s_minBucketsPerThread, 1, std::max(1u, std::thread::hardware_concurrency()))};
+    if (threads == 1)
+    {
+        scan(0, buckets);
+    }
+    else
+    {
+        const std::size_t step{(buckets + threads - 1) / threads};
+        std::vector<std::thread> workers;
+        for (std::size_t t{0}; t < threads; ++t)
+        {
+            workers.emplace_back(scan, t * step, std::min(buckets, (t + 1) * step));
+        }
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    std::lock_guard lock{m_mutex};
+    std::vector<Peak>& base{m_levels[0]};
+    base.resize(firstBucket * m_channels);
+    base.insert(base.end(), peaks.begin(), peaks.end());
+    m_frames = end;
+    rebuildLevels(firstBucket);
+}
+
+void PeakPyramid::append(const float* interleaved, const std::size_t frames)
+{
+    const std::size_t buckets{(frames + m_baseFrames - 1) / m_baseFrames};
+    std::vector<Peak> peaks(buckets * m_channels);
+    for (std::size_t bucket{0}; bucket < buckets; ++bucket)
+    {
+        const std::size_t first{bucket * m_baseFrames};
+        const std::size_t last{std::min(first + m_baseFrames, frames)};
+
+        std::array<float, SampleStore::s_maxChannels> low{};
+        std::array<float, SampleStore::s_maxChannels> high{};
+        Kernels::minMax(interleaved + first * m_channels, m_channels, last - first, low.data(), high.data());
+        for (int c{0}; c < m_channels; ++c)
+        {
+            peaks[bucket * m_channels + c] = Peak{Kernels::toInt16(low[c]), Kernels::toInt16(high[c])};
+        }
+    }
+
+    std::lock_guard lock{m_mutex};
+    std::vector<Peak>& base{m_levels[0]};
+    const std::size_t firstBucket{base.size() / m_channels};
+    base.insert(base.end(), peaks.begin(), peaks.end());
+    m_frames += frames;
+    rebuildLevels(firstBucket);
+}
+
+std::vector<PeakPyramid::Peak> PeakPyramid::baseLevel() const
+{
+    std::lock_guard lock{m_mutex};
+    return m_levels[0];
+}
+
+void PeakPyramid::assign(std::vector<Peak> base, const std::size_t frames)
+{
+    std::lock_guard lock{m_mutex};
+    m_levels.clear();
+    m_levels.emplace_back(std::move(base));
+    m_frames = frames;
+    rebuildLevels(0);
+}
+
+void PeakPyramid::rebuildLevels(std::size_t first)
+{
+    for (std::size_t level{1};; ++level)
+    {
+        const std::size_t belowCount{m_levels[level - 1].size() / m_channels};
+        if (belowCount <= 1)
+        {
+            break;
+        }
+
+        if (m_levels.size() <= level)
+        {
+            m_levels.emplace_back();
+        }
+
+        const std::vector<Peak>& below{m_levels[level - 1]};
+        std::vector<Peak>& current{m_levels[level]};
+
+        first /= s_factor;
+        const std::size_t count{(belowCount + s_factor - 1) / s_factor};
+        current.resize(count * m_channels);
+
+        for (std::size_t bucket{first}; bucket < count; ++bucket)
+        {
+            const std::size_t last{std::min((bucket + 1) * s_factor, belowCount)};
+            for (int c{0}; c < m_channels; ++c)
+            {
+                Peak peak{std::numeric_limits<std::int16_t>::max(), std::numeric_limits<std::int16_t>::min()};
+                for (std::size_t j{bucket * s_factor}; j < last; ++j)
+                {
+                    peak.min = std::min(peak.min, below[j * m_channels + c].min);
+                    peak.max = std::max(peak.max, below[j * m_channels + c].max);
+                }
+                current[bucket * m_channels + c] = peak;
+            }
+        }
+    }
+}
+
+QList<float> PeakPyramid::range(const std::size_t startFrame, const std::size_t endFrame, const int count) const
+{
+    QList<float> result{};
+    if (count <= 0 || endFrame <= startFrame)
+    {
+        return result;
+    }
+    result.resize(static_cast<qsizetype>(count) * m_channels * 2);
+
+    std::lock_guard lock{m_mutex};
+
+    // coarsest level whose buckets still fit inside one output bucket
+    const double framesPerBucket{static_cast<double>(endFrame - startFrame) / count};
+    std::size_t level{0};
+    std::size_t levelFrames{m_baseFrames};
+    while (level + 1 < m_levels.size() && static_cast<double>(levelFrames * s_factor) <= framesPerBucket)
+    {
+        ++level;
+        levelFrames *= s_factor;
+    }
+
+    const std::vector<Peak>& peaks{m_levels[level]};
+    const std::size_t available{peaks.size() / m_channels};
+
+    for (int i{0}; i < count; ++i)
+    {
+        const double from{static_cast<double>(startFrame) + i * framesPerBucket};
+        const std::size_t first{static_cast<std::size_t>(from) / levelFrames};
+        if (first >= available)
+        {
+            break;
+        }
+
+        const std::size_t last{std::clamp<std::size_t>(
+            static_cast<std::size_t>(std::ceil((from + framesPerBucket) / static_cast<double>(levelFrames))),
+            first + 1,
+            available)};
+
+        for (int c{0}; c < m_channels; ++c)
+        {
+            std::int16_t low{0};
+            std::int16_t high{0};
+            for (std::size_t j{first}; j < last; ++j)
+            {
+                low = std::min(low, peaks[j * m_channels + c].min);
+                high = std::max(high, peaks[j * m_channels + c].max);
+            }
+
+            const qsizetype index{(static_cast<qsizetype>(i) * m_channels + c) * 2};
+            result[index] = Kernels::toFloat(low);
+            result[index + 1] = Kernels::toFloat(high);
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,69 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_PEAKPYRAMID_H
+#define SPEEDSHIFTER_PEAKPYRAMID_H
+
+#include <QList>
+
+#include "samplestore.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Min/max per channel waveform peaks at several zoom levels.
+// Level 0 holds one peak per baseFrames() frames (s_baseFrames unless the pyramid has to stay small, see
+// baseFramesFor()), every level above merges s_factor peaks of the one below.
+// build() is called by the thread that fills the store, range() can be called from any thread.
+class PeakPyramid
+{
+public:
+    static constexpr std::size_t s_baseFrames{256};
+    static constexpr std::size_t s_factor{4};
+
+    struct Peak
+    {
+        std::int16_t min;
+        std::int16_t max;
+    };
+
+    // baseFrames has to be s_baseFrames times a power of s_factor
+    explicit PeakPyramid(int channels, std::size_t baseFrames = s_baseFrames);
+
+    // the finest level 0 for frames that keeps the whole pyramid (about 4/3 of level 0) within maxBytes
+    [[nodiscard]] static std::size_t baseFramesFor(std::size_t frames, int channels, std::size_t maxBytes);
+
+    [[nodiscard]] int channels() const { return m_channels; }
+    [[nodiscard]] std::size_t baseFrames() const { return m_baseFrames; }
+    // frames of the store that have peaks so far
+    [[nodiscard]] std::size_t frames() const;
+    [[nodiscard]] int levels() const;
+
+    // computes peaks for everything the store has published since the last call, split across cores
+    void build(const SampleStore& store);
+    // computes peaks for the next frames of a stream that isn't kept in a store, front to back
+    // (frames has to be a multiple of baseFrames() for all but the last call)
+    void append(const float* interleaved, std::size_t frames);
+
+    // level 0 peaks (channels interleaved), e.g. to restore the pyramid from the PCM cache
+    [[nodiscard]] std::vector<Peak> baseLevel() const;
+    void assign(std::vector<Peak> base, std::size_t frames);
+
+    // count buckets covering [startFrame, endFrame), each as min/max per channel:
+    // [min0, max0, min1, max1, ...] normalised to -1..1, taken from the coarsest level that resolves them
+    [[nodiscard]] QList<float> range(std::size_t startFrame, std::size_t endFrame, int count) const;
+
+private:
+    // merges level - 1 into level from bucket first onwards (lock must be held)
+    void rebuildLevels(std::size_t first);
+
+    const int m_channels;
+    const std::size_t m_baseFrames;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::vector<Peak>> m_levels{};
+    std::size_t m_frames{0};
+};
+
+#endif // SPEEDSHIFTER_PEAKPYRAMID_H
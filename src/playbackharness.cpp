@@ -0,0 +1,330 @@
+// Created by Jens Kromdijk 17/10/2026
+
+// Plays a track through Player without an audio device: maDataCallback is called from a simulated device clock
+// instead. In lockstep mode every period waits for the worker, so a run is as fast as the worker and always
+// produces the same output. With --realtime the clock runs at a multiple of real time with random (seeded) lateness
+// on every period, like a busy system would, and any period the worker didn't have ready counts as an underrun.
+// Every run checks that no period was starved, that playback stopped at the end of the track by itself and that
+// the amount of audio played matches the track's length at that speed. Built with SPEEDSHIFTER_RT_CHECKS, the
+// first allocation or mutex lock inside the callback aborts the run.
+// usage: speedshifter-harness [--speeds 0.5,1,2] [--seconds 30] [--rate 48000] [--channels 2] [--period 1024]
+//                             [--periods 4] [--realtime 4] [--jitter ms] [--seed 1] [--file path]
+
+#include "decoder.h"
+#include "player.h"
+#include "samplestore.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+// player.cpp, the device's data callback
+void maDataCallback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount);
+
+class PlaybackHarness
+{
+public:
+    struct Settings
+    {
+        int sampleRate{DEVICE_SAMPLERATE};
+        int channels{DEVICE_CHANNELS}; // of the device, and the sweep
+        int periodSize{DEFAULT_PERIOD_SIZE};
+        int bufferPeriods{DEFAULT_BUFFER_PERIODS};
+        double realtime{0.0}; // 0 runs in lockstep with the worker
+        double jitter{0.0};   // most a period can be late, in ms
+        unsigned seed{1};
+    };
+
+    struct Result
+    {
+        std::size_t periods{0};
+        std::size_t underruns{0};
+        std::uint64_t played{0};  // frames, up to and including the period playback stopped in
+        double expected{0.0};     // frame the track should end on
+        bool stopped{false};      // by itself, at the end of the track
+        bool length{false};       // stopped in the period the track ends in
+        double load{0.0};         // worker time per block over its deadline, on average
+        float peakLoad{0.0f};
+        double wallSeconds{0.0};
+    };
+
+    PlaybackHarness(const Settings& settings, std::shared_ptr<SampleStore> store)
+        : m_settings{settings}, m_store{std::move(store)}
+    {
+    }
+
+    Result run(const float speed)
+    {
+        Result result{};
+        Player player{};
+        player.m_periodSize = m_settings.periodSize;
+        player.m_bufferPeriods = m_settings.bufferPeriods;
+        if (!player.initHeadless(m_settings.sampleRate, m_settings.channels))
+        {
+            return result;
+        }
+
+        // what decodePCM() hands over once a file has been decoded
+        player.setSampleStore(m_store, nullptr);
+        {
+            std::lock_guard lock{player.m_progressMutex};
+            player.m_pendingProgress = {0.0f, 1.0f};
+        }
+        player.handleDecodeProgress();
+
+        player.setSpeed(speed);
+        player.setPosition(0.0f);
+        player.play();
+
+        // the worker stretches whole blocks of blockFrames * speed (rounded) source frames
+        const std::size_t period{static_cast<std::size_t>(m_settings.periodSize)};
+        const double inputFrames{std::max(std::round(static_cast<double>(period) * player.speed()), 1.0)};
+        result.expected = static_cast<double>(m_store->frames()) * static_cast<double>(period) / inputFrames;
+        // well past the end, in case playback never stops
+        const std::size_t maxPeriods{static_cast<std::size_t>(result.expected / static_cast<double>(period)) * 2 + 64};
+
+        ma_device device{};
+        device.pUserData = &player;
+        device.playback.channels = static_cast<ma_uint32>(m_settings.channels);
+        std::vector<float> output(period * m_settings.channels);
+
+        const auto ready{[&]() { return ma_pcm_rb_available_read(&player.m_ringBuffer) >= period; }};
+        const auto wallStart{std::chrono::steady_clock::now()};
+
+        const bool lockstep{m_settings.realtime <= 0.0};
+        std::chrono::steady_clock::time_point clockStart{};
+        std::chrono::duration<double> interval{};
+        std::mt19937 random{m_settings.seed};
+        std::uniform_real_distribution<double> lateness{0.0, m_settings.jitter * 1e-3};
+        if (!lockstep)
+        {
+            // a device starts on a full buffer
+            waitFor([&]() { return ma_pcm_rb_available_write(&player.m_ringBuffer) < period; });
+            clockStart = std::chrono::steady_clock::now();
+            interval = std::chrono::duration<double>(
+                static_cast<double>(period) / m_settings.sampleRate / m_settings.realtime);
+        }
+
+        while (player.playing() && result.periods < maxPeriods)
+        {
+            if (lockstep)
+            {
+                // only counts if the worker stalls
+                if (!waitFor(ready))
+                {
+                    ++result.underruns;
+                }
+            }
+            else
+            {
+                // late by up to the jitter, but the clock itself never drifts
+                const auto due{
+                    clockStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                     interval * static_cast<double>(result.periods) +
+                                     std::chrono::duration<double>(lateness(random)))};
+                std::this_thread::sleep_until(due);
+                if (!ready())
+                {
+                    ++result.underruns;
+                }
+            }
+
+            maDataCallback(&device, output.data(), nullptr, static_cast<ma_uint32>(period));
+            ++result.periods;
+            result.played += period;
+
+            // what the GUI's position timer does
+            player.updatePosition();
+        }
+
+        result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+        const PlaybackStats::Totals totals{player.m_stats.totals()};
+        result.load =
+            static_cast<double>(totals.busyNs) / static_cast<double>(std::max<std::uint64_t>(totals.deadlineNs, 1));
+        result.peakLoad = player.m_stats.takePeakLoad();
+        result.stopped = !player.playing() && player.position() == player.duration();
+        // the snapshot is rounded to a frame
+        result.length = result.expected <= static_cast<double>(result.played) + 1.0 &&
+                        result.expected > static_cast<double>(result.played - period) - 1.0;
+        return result;
+    }
+
+private:
+    // spins until done() or the worker has had a second, false if it never got there
+    template<typename Condition>
+    static bool waitFor(const Condition& done)
+    {
+        const auto deadline{std::chrono::steady_clock::now() + std::chrono::seconds{1}};
+        while (!done())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    Settings m_settings;
+    std::shared_ptr<SampleStore> m_store;
+};
+
+namespace
+{
+    constexpr double s_pi{3.14159265358979323846};
+
+    // exponential sweep, 20 Hz .. 20 kHz, in opposite directions on every other channel
+    std::shared_ptr<SampleStore> sweep(const int sampleRate, const int channels, const double seconds)
+    {
+        const std::size_t frames{static_cast<std::size_t>(seconds * sampleRate)};
+        const double k{std::log(1000.0) / seconds};
+        const auto tone{[k](const double t)
+        { return static_cast<float>(0.5 * std::sin(2.0 * s_pi * 20.0 * (std::exp(k * t) - 1.0) / k)); }};
+
+        std::vector<float> audio(frames * channels);
+        for (std::size_t f{0}; f < frames; ++f)
+        {
+            const double t{static_cast<double>(f) / sampleRate};
+            for (int c{0}; c < channels; ++c)
+            {
+                audio[f * channels + c] = tone(c % 2 == 0 ? t : seconds - t);
+            }
+        }
+
+        std::shared_ptr<SampleStore> store{SampleStore::create(SampleStore::Format::Float, channels)};
+        store->append(audio.data(), frames);
+        store->finish();
+        return store;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app{argc, argv};
+    QCoreApplication::setApplicationName("speedshifter-harness");
+
+    QCommandLineParser parser{};
+    parser.setApplicationDescription("Plays a track through the player on a simulated device and checks the output.");
+    parser.addHelpOption();
+    const QCommandLineOption speedsOption{
+        "speeds", "Comma separated speeds to play at (default 0.2,0.5,1,1.5,2).", "speeds", "0.2,0.5,1,1.5,2"};
+    const QCommandLineOption secondsOption{"seconds", "Length of the generated sweep (default 30).", "seconds", "30"};
+    const QCommandLineOption rateOption{"rate", "Device sample rate (default 48000).", "Hz", "48000"};
+    const QCommandLineOption channelsOption{"channels", "Device channels, up to 8 (default 2).", "count", "2"};
+    const QCommandLineOption periodOption{"period", "Frames per period (default 1024).", "frames", "1024"};
+    const QCommandLineOption periodsOption{"periods", "Ring buffer depth in periods (default 4).", "count", "4"};
+    const QCommandLineOption realtimeOption{
+        "realtime", "Run the device clock at this multiple of real time (default: lockstep).", "factor", "0"};
+    const QCommandLineOption jitterOption{"jitter", "Most a period can be late (default 0).", "ms", "0"};
+    const QCommandLineOption seedOption{"seed", "Seed for the jitter (default 1).", "seed", "1"};
+    const QCommandLineOption fileOption{"file", "Play this file instead of a sweep.", "path"};
+    parser.addOption(speedsOption);
+    parser.addOption(secondsOption);
+    parser.addOption(rateOption);
+    parser.addOption(channelsOption);
+    parser.addOption(periodOption);
+    parser.addOption(periodsOption);
+    parser.addOption(realtimeOption);
+    parser.addOption(jitterOption);
+    parser.addOption(seedOption);
+    parser.addOption(fileOption);
+    parser.process(app);
+
+    PlaybackHarness::Settings settings{};
+    std::vector<float> speeds{};
+    bool ok{true};
+    for (const QString& value : parser.value(speedsOption).split(','))
+    {
+        bool speedOk;
+        const float speed{value.toFloat(&speedOk)};
+        ok = ok && speedOk && speed >= MIN_SPEED && speed <= MAX_SPEED;
+        speeds.push_back(speed);
+    }
+    bool secondsOk;
+    bool rateOk;
+    bool channelsOk;
+    bool periodOk;
+    bool periodsOk;
+    bool realtimeOk;
+    bool jitterOk;
+    bool seedOk;
+    const double seconds{parser.value(secondsOption).toDouble(&secondsOk)};
+    settings.sampleRate = parser.value(rateOption).toInt(&rateOk);
+    settings.channels = parser.value(channelsOption).toInt(&channelsOk);
+    settings.periodSize = parser.value(periodOption).toInt(&periodOk);
+    settings.bufferPeriods = parser.value(periodsOption).toInt(&periodsOk);
+    settings.realtime = parser.value(realtimeOption).toDouble(&realtimeOk);
+    settings.jitter = parser.value(jitterOption).toDouble(&jitterOk);
+    settings.seed = parser.value(seedOption).toUInt(&seedOk);
+    if (!ok || !secondsOk || seconds <= 0.0 || !rateOk || settings.sampleRate <= 0 || !channelsOk ||
+        settings.channels < 1 || settings.channels > MAX_DEVICE_CHANNELS || !periodOk ||
+        settings.periodSize < MIN_PERIOD_SIZE || settings.periodSize > MAX_PERIOD_SIZE || !periodsOk ||
+        settings.bufferPeriods < MIN_BUFFER_PERIODS || settings.bufferPeriods > MAX_BUFFER_PERIODS || !realtimeOk ||
+        settings.realtime < 0.0 || !jitterOk || settings.jitter < 0.0 || !seedOk)
+    {
+        std::fprintf(stderr, "invalid option, see --help\n");
+        return 1;
+    }
+
+    std::shared_ptr<SampleStore> store{};
+    if (parser.isSet(fileOption))
+    {
+        // decoded the way loadFile() does it
+        const QString file{parser.value(fileOption)};
+        const std::atomic<bool> running{true};
+        bool complete{false};
+        store = Decoder::decode(
+            file,
+            SampleStore::Format::Float,
+            settings.sampleRate,
+            settings.channels,
+            running,
+            nullptr,
+            nullptr,
+            &complete);
+        if (!store || !complete || store->frames() == 0)
+        {
+            std::fprintf(stderr, "failed to decode %s\n", qPrintable(file));
+            return 1;
+        }
+        store->finish();
+    }
+    else
+    {
+        store = sweep(settings.sampleRate, settings.channels, seconds);
+    }
+
+    PlaybackHarness harness{settings, store};
+    bool passed{true};
+    for (const float speed : speeds)
+    {
+        const PlaybackHarness::Result result{harness.run(speed)};
+        const bool ran{result.periods > 0};
+        const bool fine{ran && result.underruns == 0 && result.stopped && result.length};
+        passed = passed && fine;
+        std::printf(
+            "%-4s %5.2fx  %zu periods, %zu underruns, played %llu frames for %.1f expected, %s in %.2f s, "
+            "load %.0f%% (peak %.0f%%)\n",
+            fine ? "ok" : "FAIL",
+            speed,
+            result.periods,
+            result.underruns,
+            static_cast<unsigned long long>(result.played),
+            result.expected,
+            !ran ? "no device" : result.stopped ? "stopped at the end" : "never stopped",
+            result.wallSeconds,
+            result.load * 100.0,
+            result.peakLoad * 100.0);
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_PLAYBACKSTATS_H
+#define SPEEDSHIFTER_PLAYBACKSTATS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// Counters the audio callback and the worker keep about how playback is going, read by the GUI.
+// Every counter has a single writer, so updating one is a relaxed load and store, never a lock or a wait.
+class PlaybackStats
+{
+public:
+    // block time in steps of an eighth of the block's deadline, the last bucket holds everything from 2 deadlines up
+    static constexpr std::size_t s_buckets{16};
+    static constexpr double s_bucketWidth{0.125};
+
+    struct Totals
+    {
+        std::uint64_t periods{0};       // device callbacks while playing
+        std::uint64_t underruns{0};     // periods the ring buffer didn't have enough for
+        std::uint64_t silentFrames{0};  // zero-filled because of those
+        std::uint64_t shortWrites{0};   // blocks that didn't fit into the ring buffer whole
+        std::uint64_t droppedFrames{0}; // stretcher output lost because of those
+        std::uint64_t timelineDrops{0}; // blocks the timeline had no room for, the position is off until the next one
+        std::uint64_t blocks{0};
+        std::uint64_t busyNs{0};     // spent processing blocks
+        std::uint64_t deadlineNs{0}; // how long those blocks play for
+        std::array<std::uint64_t, s_buckets> histogram{};
+    };
+
+    // audio callback, fill is what is left in the ring buffer after the period
+    void period(const std::uint32_t fill)
+    {
+        add(m_periods, 1);
+        m_fill.store(fill, std::memory_order_relaxed);
+        lower(m_minFill, fill);
+    }
+
+    void underrun(const std::uint32_t silentFrames)
+    {
+        add(m_underruns, 1);
+        add(m_silentFrames, silentFrames);
+    }
+
+    // worker
+    void shortWrite(const std::uint32_t droppedFrames)
+    {
+        add(m_shortWrites, 1);
+        add(m_droppedFrames, droppedFrames);
+    }
+
+    void timelineDrop() { add(m_timelineDrops, 1); }
+
+    void block(const std::chrono::nanoseconds busy, const std::chrono::nanoseconds deadline)
+    {
+        const double load{
+            static_cast<double>(busy.count()) / static_cast<double>(std::max<std::int64_t>(deadline.count(), 1))};
+        add(m_blocks, 1);
+        add(m_busyNs, static_cast<std::uint64_t>(busy.count()));
+        add(m_deadlineNs, static_cast<std::uint64_t>(deadline.count()));
+        add(m_histogram[std::min(static_cast<std::size_t>(load / s_bucketWidth), s_buckets - 1)], 1);
+
+        // the GUI resets it, so it can't just be stored
+        float peak{m_peakLoad.load(std::memory_order_relaxed)};
+        while (static_cast<float>(load) > peak &&
+               !m_peakLoad.compare_exchange_weak(peak, static_cast<float>(load), std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // anyone, counters only ever grow
+    [[nodiscard]] Totals totals() const
+    {
+        Totals totals{};
+        totals.periods = m_periods.load(std::memory_order_relaxed);
+        totals.underruns = m_underruns.load(std::memory_order_relaxed);
+        totals.silentFrames = m_silentFrames.load(std::memory_order_relaxed);
+        totals.shortWrites = m_shortWrites.load(std::memory_order_relaxed);
+        totals.droppedFrames = m_droppedFrames.load(std::memory_order_relaxed);
+        totals.timelineDrops = m_timelineDrops.load(std::memory_order_relaxed);
+        totals.blocks = m_blocks.load(std::memory_order_relaxed);
+        totals.busyNs = m_busyNs.load(std::memory_order_relaxed);
+        totals.deadlineNs = m_deadlineNs.load(std::memory_order_relaxed);
+        for (std::size_t i{0}; i < s_buckets; ++i)
+        {
+            totals.histogram[i] = m_histogram[i].load(std::memory_order_relaxed);
+        }
+        return totals;
+    }
+
+    [[nodiscard]] std::uint32_t fill() const { return m_fill.load(std::memory_order_relaxed); }
+
+    // lowest fill and highest block load since the last call (the current fill and 0 if there were none)
+    [[nodiscard]] std::uint32_t takeMinFill()
+    {
+        const std::uint32_t minFill{m_minFill.exchange(s_noFill, std::memory_order_relaxed)};
+        return minFill == s_noFill ? fill() : minFill;
+    }
+
+    [[nodiscard]] float takePeakLoad() { return m_peakLoad.exchange(0.0f, std::memory_order_relaxed); }
+
+private:
+    static constexpr std::uint32_t s_noFill{std::numeric_limits<std::uint32_t>::max()};
+
+    // single writer, so no read-modify-write instruction needed
+    static void add(std::atomic<std::uint64_t>& counter, const std::uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    // the GUI resets it, so it can't just be stored
+    static void lower(std::atomic<std::uint32_t>& minimum, const std::uint32_t value)
+    {
+        std::uint32_t current{minimum.load(std::memory_order_relaxed)};
+        while (value < current && !minimum.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    std::atomic<std::uint64_t> m_periods{0};
+    std::atomic<std::uint64_t> m_underruns{0};
+    std::atomic<std::uint64_t> m_silentFrames{0};
+    std::atomic<std::uint64_t> m_shortWrites{0};
+    std::atomic<std::uint64_t> m_droppedFrames{0};
+    std::atomic<std::uint64_t> m_timelineDrops{0};
+    std::atomic<std::uint64_t> m_blocks{0};
+    std::atomic<std::uint64_t> m_busyNs{0};
+    std::atomic<std::uint64_t> m_deadlineNs{0};
+    std::array<std::atomic<std::uint64_t>, s_buckets> m_histogram{};
+
+    std::atomic<std::uint32_t> m_fill{0};
+    std::atomic<std::uint32_t> m_minFill{s_noFill};
+    std::atomic<float> m_peakLoad{0.0f};
+};
+
+#endif // SPEEDSHIFTER_PLAYBACKSTATS_H
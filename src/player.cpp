@@ -1,481 +1,1427 @@
 // Created by Jens Kromdijk 23/05/2026
 
 #include "player.h"
+#include "decoder.h"
+#include "kernels.h"
+#include "pcmcache.h"
+#include "rtcheck.h"
+#include "seekabledecoder.h"
+#include "streamedstore.h"
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <chrono>
+#include <cmath>
+#include <optional>
 #include <qnamespace.h>
 #include <thread>
 
-extern "C" {
-#include <libavformat/avformat.h>
-#include <libavcodec/avcodec.h>
-#include <libavutil/avutil.h>
-#include <libswresample/swresample.h>
-#include <libavutil/opt.h>
-}
+namespace
+{
+    // HighQuality, presetDefault is 120 ms blocks every 30 ms
+    constexpr float s_highQualityBlock{0.16f};
+    constexpr float s_highQualityInterval{0.025f};
+
+    // from fades out as to fades in over frames into out, which may be either of them
+    void crossfade(
+        const float* const* from,
+        const float* const* to,
+        float* const* out,
+        const int channels,
+        const std::size_t frames)
+    {
+        for (std::size_t f{0}; f < frames; ++f)
+        {
+            // sin² fades sum to one, both sides are the same audio apart from how it was stretched
+            const float angle{(static_cast<float>(f) + 0.5f) / static_cast<float>(frames) * 1.5707964f};
+            const float fadeIn{std::sin(angle) * std::sin(angle)};
+            for (int c{0}; c < channels; ++c)
+            {
+                out[c][f] = from[c][f] + (to[c][f] - from[c][f]) * fadeIn;
+            }
+        }
+    }
+
+    // the first channels of buffers from frame offset on, the layout the stores and the stretchers take
+    std::array<float*, MAX_DEVICE_CHANNELS> channelPointers(
+        std::array<std::vector<float>, MAX_DEVICE_CHANNELS>& buffers,
+        const int channels,
+        const std::size_t offset = 0)
+    {
+        std::array<float*, MAX_DEVICE_CHANNELS> pointers{};
+        for (int c{0}; c < channels; ++c)
+        {
+            pointers[c] = buffers[c].data() + offset;
+        }
+        return pointers;
+    }
+} // namespace
+
+namespace
+{
+    struct LatencySettings
+    {
+        int periodSize;
+        int bufferPeriods;
+    };
+
+    // same order as Player::LatencyPreset
+    constexpr std::array<LatencySettings, 3> s_latencyPresets{{
+        {256, 3},
+        {DEFAULT_PERIOD_SIZE, DEFAULT_BUFFER_PERIODS},
+        {4096, 4},
+    }};
+} // namespace
 
 void maDataCallback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount)
 {
+    // nothing in here may allocate, lock or wait (checked in builds with SPEEDSHIFTER_RT_CHECKS)
+    [[maybe_unused]] const RealtimeScope realtime{};
     Player* player{static_cast<Player*>(pDevice->pUserData)};
     if (!player || !player->playing())
     {
+        if (player)
+        {
+            // the worker gets a head start again before anything counts as an underrun
+            player->m_callback.primed = false;
+        }
         // zero output
-        std::memset(pOutput, 0, frameCount * pDevice->playback.channels * sizeof(float));
+        Kernels::zero(static_cast<float*>(pOutput), frameCount * pDevice->playback.channels);
         return;
     }
 
     float* outputBuffer{static_cast<float*>(pOutput)};
-    ma_uint32 frames{frameCount};
+    const ma_uint32 channels{pDevice->playback.channels};
+    ma_pcm_rb* ringBuffer{&player->m_ringBuffer};
     void* pReadBuffer;
 
-    ma_result result{ma_pcm_rb_acquire_read(&player->m_ringBuffer, &frames, &pReadBuffer)};
-
-    if (result == MA_SUCCESS && frames > 0)
+    // skip whatever the worker queued before the last seek
+    std::uint64_t ringRead{player->m_ringRead.load(std::memory_order_relaxed)};
+    const std::uint64_t discardUntil{player->m_ringDiscardUntil.load(std::memory_order_acquire)};
+    if (ringRead < discardUntil)
     {
-        // copy memory from ring buffer
-        std::memcpy(outputBuffer, pReadBuffer, frames * DEVICE_CHANNELS * sizeof(float));
-        ma_pcm_rb_commit_read(&player->m_ringBuffer, frames);
-
-        player->m_frameCount.fetch_add(
-            static_cast<std::size_t>(static_cast<float>(frameCount) * player->m_speed.load()));
+        player->m_callback.primed = false;
+    }
+    while (ringRead < discardUntil)
+    {
+        ma_uint32 stale{static_cast<ma_uint32>(std::min<std::uint64_t>(discardUntil - ringRead, UINT32_MAX))};
+        if (ma_pcm_rb_acquire_read(ringBuffer, &stale, &pReadBuffer) != MA_SUCCESS || stale == 0)
+        {
+            break;
+        }
+        ma_pcm_rb_commit_read(ringBuffer, stale);
+        ringRead += stale;
+    }
 
-        if (frames < frameCount)
+    // copy memory from ring buffer (in two parts if it wraps around)
+    ma_uint32 frames{0};
+    while (frames < frameCount)
+    {
+        ma_uint32 available{frameCount - frames};
+        if (ma_pcm_rb_acquire_read(ringBuffer, &available, &pReadBuffer) != MA_SUCCESS || available == 0)
         {
-            // clear rest of frames
-            std::memset(
-                outputBuffer + (frames * DEVICE_CHANNELS), 0, (frameCount - frames) * DEVICE_CHANNELS * sizeof(float));
+            break;
         }
+        std::memcpy(outputBuffer + frames * channels, pReadBuffer, available * channels * sizeof(float));
+        ma_pcm_rb_commit_read(ringBuffer, available);
+        frames += available;
     }
-    else
+    player->m_ringRead.store(ringRead + frames, std::memory_order_relaxed);
+
+    player->m_stats.period(ma_pcm_rb_available_read(ringBuffer));
+    if (frames < frameCount && player->m_callback.primed)
     {
-        // zero output
-        std::memset(pOutput, 0, frameCount * pDevice->playback.channels * sizeof(float));
+        player->m_stats.underrun(frameCount - frames);
+    }
+    player->m_callback.primed = player->m_callback.primed || frames == frameCount;
+
+    // position of the frame leaving the speakers right now, the device still has its own buffer to play first
+    if (frames > 0)
+    {
+        player->m_timeline.played(ringRead, frames);
+    }
+    if (frames < frameCount)
+    {
+        player->m_timeline.silent(frameCount - frames);
     }
+    const Timeline::Block heard{player->m_timeline.heard(player->m_callback.deviceLatency)};
 
-    player->updatePositionCallback();
+    // the GUI polls this, nothing on this thread touches Qt
+    player->m_snapshot.store(
+        {static_cast<std::uint64_t>(std::max(heard.source, 0.0) + 0.5), heard.seek, frames > 0});
+
+    if (frames < frameCount)
+    {
+        // clear rest of frames
+        Kernels::zero(outputBuffer + (frames * channels), (frameCount - frames) * channels);
+    }
+
+    // refill as soon as another block fits
+    if (frames < frameCount || ma_pcm_rb_available_write(ringBuffer) >= player->m_callback.refillFrames)
+    {
+        player->m_workerWake.signal();
+    }
 }
 
 Player::Player(QObject* parent) : QObject{parent}
 {
-    connect(this, &Player::signalStop, this, &Player::handleStop, Qt::QueuedConnection);
-    connect(this, &Player::signalPositionUpdate, this, &Player::updatePosition, Qt::QueuedConnection);
+    // the playhead follows the audio at display rate while playing
+    m_positionTimer.setInterval(POSITION_INTERVAL);
+    m_positionTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_positionTimer, &QTimer::timeout, this, &Player::updatePosition);
+    m_statsTimer.setInterval(STATS_INTERVAL);
+    connect(&m_statsTimer, &QTimer::timeout, this, &Player::updateStats);
+    m_loopRenderTimer.setInterval(LOOP_RENDER_DELAY);
+    m_loopRenderTimer.setSingleShot(true);
+    connect(&m_loopRenderTimer, &QTimer::timeout, this, &Player::renderLoop);
+    connect(this, &Player::signalLoopRendered, this, &Player::handleLoopRendered, Qt::QueuedConnection);
+    connect(this, &Player::signalDecodeProgress, this, &Player::handleDecodeProgress, Qt::QueuedConnection);
+
+    // for enumerating devices, the device itself is opened when the first file is loaded
+    if (ma_context_init(nullptr, 0, nullptr, &m_context) == MA_SUCCESS)
+    {
+        m_contextInit = true;
+        refreshDevices();
+    }
+    else
+    {
+        qWarning() << "Failed to initialize MiniAudio context!";
+    }
+
+    const QString statsLog{qEnvironmentVariable("SPEEDSHIFTER_STATS_LOG")};
+    if (!statsLog.isEmpty())
+    {
+        m_statsLog.setFileName(statsLog);
+        if (!m_statsLog.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+        {
+            qWarning() << "Failed to open stats log" << statsLog;
+        }
+    }
 
     // get ready to process data
-    m_processData.store(true);
     initWorkerThread();
 }
 
-Player::~Player()
+Player::~Player()
+{
+    stopDecoder();
+    stopLoopRender();
+
+    // stop processing before device is destroyed
+    stopWorkerThread();
+
+    if (m_deviceInit)
+    {
+        ma_device_uninit(&m_device);
+    }
+
+    if (m_rbInit)
+    {
+        ma_pcm_rb_uninit(&m_ringBuffer);
+    }
+
+    if (m_contextInit)
+    {
+        ma_context_uninit(&m_context);
+    }
+}
+
+void Player::setFilePath(const QString& path)
+{
+    if (m_filePath != path)
+    {
+        m_filePath = path;
+        Q_EMIT filePathChanged();
+    }
+}
+
+std::shared_ptr<SampleStore> Player::getSampleStore() const
+{
+    std::lock_guard lock{m_sampleStoreMutex};
+    return m_sampleStore;
+}
+
+std::shared_ptr<PeakPyramid> Player::getPeakPyramid() const
+{
+    std::lock_guard lock{m_sampleStoreMutex};
+    return m_peakPyramid;
+}
+
+void Player::setSampleStore(std::shared_ptr<SampleStore> store, std::shared_ptr<PeakPyramid> peaks)
+{
+    {
+        std::lock_guard lock{m_sampleStoreMutex};
+        m_sampleStore = std::move(store);
+        m_peakPyramid = std::move(peaks);
+    }
+    m_workerWake.signal();
+}
+
+void Player::setSampleStorage(const SampleStorage storage)
+{
+    if (m_sampleStorage != storage)
+    {
+        m_sampleStorage = storage;
+        Q_EMIT sampleStorageChanged();
+    }
+}
+
+void Player::updatePosition()
+{
+    const PlaybackSnapshot snapshot{m_snapshot.load()};
+    // still audio from before the last seek (or nothing was played since), setPosition() already moved the playhead
+    if (snapshot.seek != m_seekSerial || !snapshot.playing)
+    {
+        return;
+    }
+
+    // the last source frame has been heard
+    const std::shared_ptr<SampleStore> store{getSampleStore()};
+    if (m_decodeFinished && store && snapshot.frame >= store->frames())
+    {
+        m_position = m_duration;
+        pause();
+        Q_EMIT positionChanged();
+        return;
+    }
+
+    const float pos{static_cast<float>(snapshot.frame) / static_cast<float>(m_sampleRate)};
+    if (pos != m_position)
+    {
+        m_position = pos;
+        Q_EMIT positionChanged();
+    }
+}
+
+void Player::setPosition(float seconds)
+{
+    seconds = std::clamp(seconds, 0.0f, m_duration);
+
+    // applied by the worker before its next block
+    // (the decoder may not have reached this point yet, processPCM waits for it)
+    pushCommand({Command::Type::Seek, static_cast<std::size_t>(seconds * static_cast<float>(m_sampleRate)),
+                 1.0f, ++m_seekSerial});
+
+    m_position = seconds;
+    Q_EMIT positionChanged();
+}
+
+void Player::pushCommand(const Command& command)
+{
+    if (!m_commands.push(command))
+    {
+        qWarning() << "Player command queue is full, dropping command!";
+    }
+    m_workerWake.signal();
+}
+
+void Player::applyCommands()
+{
+    // only the newest seek matters, so scrubbing costs at most one seek per block
+    std::optional<std::size_t> seek{};
+    std::uint32_t serial{0};
+    bool reset{false};
+    std::optional<StretchQuality> quality{};
+
+    Command command;
+    while (m_commands.pop(command))
+    {
+        switch (command.type)
+        {
+        case Command::Type::Seek:
+            seek = command.frame;
+            serial = command.serial;
+            break;
+        case Command::Type::Speed:
+            m_blockSpeed = command.speed;
+            break;
+        case Command::Type::Reset:
+            seek = command.frame;
+            serial = command.serial;
+            reset = true;
+            break;
+        case Command::Type::Quality:
+            quality = command.quality;
+            break;
+        case Command::Type::Loop:
+            m_blockLoopStart = command.frame;
+            m_blockLoopEnd = command.end;
+            break;
+        }
+    }
+
+    if (!seek && !quality)
+    {
+        return;
+    }
+
+    const std::shared_ptr<SampleStore> store{getSampleStore()};
+    GroupStretcher& active{m_stretchers[m_activeStretcher]};
+
+    if (quality && *quality != m_blockQuality)
+    {
+        m_blockQuality = *quality;
+        const double source{static_cast<double>(m_readIndex.load()) - blockLatency(m_blockSpeed)};
+        if (seek || !store || source < 0.0)
+        {
+            // nothing to fade from, or it's about to be thrown away anyway
+            configureStretcher(active, m_blockQuality);
+            m_fading = false;
+        }
+        else
+        {
+            // the other stretcher picks up at the frame the active one would play next, see processPCM()
+            GroupStretcher& next{m_stretchers[1 - m_activeStretcher]};
+            configureStretcher(next, m_blockQuality);
+            m_fadeReadIndex = static_cast<std::size_t>(source + blockLatency(next, m_blockSpeed) + 0.5);
+            primeStretcher(next, *store, m_fadeReadIndex, m_blockSpeed);
+            m_fading = true;
+        }
+    }
+
+    if (!seek)
+    {
+        return;
+    }
+
+    // everything still queued for the device is from before the seek
+    m_ringDiscardUntil.store(m_ringWritten, std::memory_order_release);
+    m_blockSeek = serial;
+    m_loop = nullptr;
+    if (m_fading)
+    {
+        // the other one is configured already, there's just nothing to fade anymore
+        m_activeStretcher = 1 - m_activeStretcher;
+        m_fading = false;
+    }
+    GroupStretcher& stretcher{m_stretchers[m_activeStretcher]};
+    stretcher.reset();
+
+    if (reset || !store)
+    {
+        m_readIndex.store(*seek);
+        return;
+    }
+
+    // read on by the stretcher's latency so the first output frame lands exactly on the target
+    const std::size_t start{*seek + static_cast<std::size_t>(blockLatency(m_blockSpeed) + 0.5)};
+    m_readIndex.store(start);
+    primeStretcher(stretcher, *store, start, m_blockSpeed);
+}
+
+void Player::primeStretcher(
+    GroupStretcher& stretcher,
+    const SampleStore& store,
+    const std::size_t start,
+    const float speed)
+{
+    const std::size_t preRoll{
+        std::min(start, static_cast<std::size_t>(stretcher.blockSamples() + stretcher.intervalSamples()))};
+    if (preRoll == 0)
+    {
+        stretcher.reset();
+        return;
+    }
+
+    // feed the stretcher what comes right before that, so the first block already starts there
+    const int channels{stretchedChannels(store)};
+    const std::array<float*, MAX_DEVICE_CHANNELS> input{channelPointers(m_inputBuffer, channels)};
+    const std::size_t frames{store.read(start - preRoll, preRoll, input.data(), channels)};
+    for (int c{0}; c < channels; ++c)
+    {
+        Kernels::zero(input[c] + frames, preRoll - frames);
+    }
+    stretcher.seek(input.data(), static_cast<int>(preRoll), speed, channels);
+}
+
+void Player::crossfadeStretchers(const SampleStore& store, const std::size_t inputFrames, const std::size_t blockFrames)
+{
+    // the other stretcher makes the same block from its own read position
+    const int channels{stretchedChannels(store)};
+    const std::array<float*, MAX_DEVICE_CHANNELS> input{channelPointers(m_inputBuffer, channels)};
+    const std::size_t frames{store.read(m_fadeReadIndex, inputFrames, input.data(), channels)};
+    for (int c{0}; c < channels; ++c)
+    {
+        Kernels::zero(input[c] + frames, inputFrames - frames);
+    }
+    const std::array<float*, MAX_DEVICE_CHANNELS> next{channelPointers(m_fadeBuffer, m_channels)};
+    m_stretchers[1 - m_activeStretcher].process(
+        input.data(), static_cast<int>(inputFrames), next.data(), static_cast<int>(blockFrames), channels);
+
+    const std::array<float*, MAX_DEVICE_CHANNELS> output{channelPointers(m_outputBuffer, m_channels)};
+    crossfade(output.data(), next.data(), output.data(), m_channels, blockFrames);
+
+    m_readIndex.store(m_fadeReadIndex + inputFrames);
+    m_activeStretcher = 1 - m_activeStretcher;
+    m_fading = false;
+}
+
+void Player::wrapLoop(const SampleStore& store)
+{
+    m_loop = m_loopCache.find(m_blockLoopStart, m_blockLoopEnd, m_blockSpeed);
+    m_loopOffset = 0;
+    if (m_loop)
+    {
+        return;
+    }
+
+    // not rendered yet, so it's stretched live and only wraps at a block boundary
+    const std::size_t start{m_blockLoopStart + static_cast<std::size_t>(blockLatency(m_blockSpeed) + 0.5)};
+    m_readIndex.store(start);
+    primeStretcher(m_stretchers[m_activeStretcher], store, start, m_blockSpeed);
+}
+
+void Player::leaveLoop(const SampleStore& store)
+{
+    const double source{static_cast<double>(m_loop->start) + static_cast<double>(m_loopOffset) * m_loop->speed};
+    m_loop = nullptr;
+
+    // whichever configuration is due, it starts over here anyway
+    if (m_fading)
+    {
+        m_activeStretcher = 1 - m_activeStretcher;
+        m_fading = false;
+    }
+    const std::size_t start{static_cast<std::size_t>(source + blockLatency(m_blockSpeed) + 0.5)};
+    m_readIndex.store(start);
+    primeStretcher(m_stretchers[m_activeStretcher], store, start, m_blockSpeed);
+}
+
+void Player::pushTimeline(const Timeline::Block& block)
+{
+    if (!m_timeline.pushBlock(block))
+    {
+        m_stats.timelineDrop();
+    }
+}
+
+void Player::readLoop(
+    const LoopCache::Loop& loop,
+    float* const* out,
+    const std::size_t frames,
+    const std::optional<std::uint64_t> ringFrame)
+{
+    for (std::size_t done{0}; done < frames;)
+    {
+        if (m_loopOffset >= loop.frames())
+        {
+            m_loopOffset = 0;
+        }
+        const std::size_t count{std::min(frames - done, loop.frames() - m_loopOffset)};
+        loop.read(m_loopOffset, count, out, done);
+
+        if (ringFrame)
+        {
+            pushTimeline(
+                {*ringFrame + done,
+                 static_cast<double>(loop.start) + static_cast<double>(m_loopOffset) * loop.speed,
+                 loop.speed,
+                 m_blockSeek});
+        }
+        m_loopOffset += count;
+        done += count;
+    }
+}
+
+void Player::configureStretcher(GroupStretcher& stretcher, const StretchQuality quality) const
+{
+    // allocates, but only the worker does this and the ring buffer covers for it
+    switch (quality)
+    {
+    case CheaperQuality:
+        stretcher.presetCheaper(m_channels, static_cast<float>(m_sampleRate));
+        break;
+    case DefaultQuality:
+        stretcher.presetDefault(m_channels, static_cast<float>(m_sampleRate));
+        break;
+    case HighQuality:
+        stretcher.configure(
+            m_channels,
+            static_cast<int>(s_highQualityBlock * static_cast<float>(m_sampleRate)),
+            static_cast<int>(s_highQualityInterval * static_cast<float>(m_sampleRate)));
+        break;
+    }
+}
+
+int Player::stretchedChannels(const SampleStore& store) const
+{
+    // mono is spread over a whole group, the front pair
+    return m_stretchers[m_activeStretcher].groupedChannels(std::min(store.channels(), m_channels));
+}
+
+double Player::blockLatency(const float speed) const
+{
+    return blockLatency(m_stretchers[m_activeStretcher], speed);
+}
+
+double Player::blockLatency(const GroupStretcher& stretcher, const float speed)
+{
+    // input latency is in source frames, output latency in output frames
+    return static_cast<double>(stretcher.inputLatency()) + static_cast<double>(stretcher.outputLatency()) * speed;
+}
+
+void Player::play()
+{
+    if (!m_playing)
+    {
+        m_playing = true;
+        m_workerWake.signal();
+        m_positionTimer.start();
+        m_statsTimer.start();
+        Q_EMIT playingChanged();
+        if (m_deviceInit)
+        {
+            ma_device_start(&m_device);
+        }
+    }
+}
+
+void Player::pause()
+{
+    if (m_playing)
+    {
+        m_playing = false;
+        m_workerWake.signal();
+        m_positionTimer.stop();
+        m_statsTimer.stop();
+        updateStats();
+        Q_EMIT playingChanged();
+        if (m_deviceInit)
+        {
+            ma_device_stop(&m_device);
+        }
+    }
+}
+
+void Player::setSpeed(const float t)
+{
+    m_speed.store(std::clamp(t, MIN_SPEED, MAX_SPEED));
+
+    Command command{Command::Type::Speed};
+    command.speed = m_speed.load();
+    pushCommand(command);
+
+    Q_EMIT speedChanged();
+    // a loop has to be rendered again for every speed
+    updateLoop();
+}
+
+void Player::loadFile(const QUrl& fileUrl)
+{
+    pause();
+    // abandon whatever is still being decoded
+    stopDecoder();
+    setPosition(0);
+
+    // everything is converted to the device's format while decoding, so open it first to know its rate
+    // (without a device we still decode, at the default rate)
+    if (!m_deviceInit)
+    {
+        initDevice();
+    }
+    m_loadedFile = fileUrl;
+
+    // previously decoded files are mapped straight from the cache, streamed ones would never fit in it
+    const QString filePath{fileUrl.toLocalFile()};
+    const bool streamed{m_sampleStorage == Streamed};
+    std::optional<PCMCache::Entry> cached{streamed ? std::nullopt : PCMCache::load(filePath, m_sampleRate, m_channels)};
+
+    // otherwise the decoder sets up a store once it knows the channel layout
+    setSampleStore(cached ? cached->store : nullptr, cached ? cached->peaks : nullptr);
+    {
+        std::lock_guard lock{m_progressMutex};
+        m_pendingProgress = DecodeProgress{};
+    }
+
+    m_estimatedDuration = 0.0f;
+    m_duration = cached ? static_cast<float>(cached->store->frames()) / static_cast<float>(m_sampleRate) : 0.0f;
+    m_decodeFinished = cached.has_value();
+    m_position = 0.0f;
+    m_loading = !cached;
+    m_loadProgress = cached ? 1.0f : 0.0f;
+
+    Q_EMIT durationChanged();
+    Q_EMIT positionChanged();
+    Q_EMIT waveformChanged();
+    Q_EMIT loadingChanged();
+    Q_EMIT loadProgressChanged();
+
+    // loops belong to the previous file
+    stopLoopRender();
+    m_loopCache.clear();
+    m_loopStart = 0.0f;
+    m_loopEnd = 0.0f;
+    m_looping = false;
+    updateLoop();
+    Q_EMIT loopChanged();
+
+    // back to the start without pre-roll, the worker flushes the ring buffer and the stretcher
+    pushCommand({Command::Type::Reset, 0, 1.0f, ++m_seekSerial});
+
+    if (cached)
+    {
+        return;
+    }
+
+    // open + decode in the background, playback can start as soon as the first frames arrive
+    m_decodeData.store(true);
+    if (streamed)
+    {
+        m_decoder = std::thread(&Player::streamPCM, this, filePath, m_sampleRate, m_channels);
+        return;
+    }
+    m_decoder = std::thread(
+        &Player::decodePCM,
+        this,
+        filePath,
+        static_cast<SampleStore::Format>(m_sampleStorage),
+        m_sampleRate,
+        m_channels);
+}
+
+bool Player::initDevice()
+{
+    // nothing may touch the device or the ring buffer while they're replaced
+    stopWorkerThread();
+
+    if (m_deviceInit)
+    {
+        ma_device_uninit(&m_device);
+        m_deviceInit = false;
+    }
+
+    if (m_rbInit)
+    {
+        ma_pcm_rb_uninit(&m_ringBuffer);
+        m_rbInit = false;
+    }
+
+    const auto open{[this]()
+    {
+        ma_device_config deviceConfig{ma_device_config_init(ma_device_type_playback)};
+        const bool selected{m_outputDevice >= 0 && m_outputDevice < static_cast<int>(m_deviceIds.size())};
+        deviceConfig.playback.pDeviceID = selected ? &m_deviceIds[m_outputDevice] : nullptr;
+        deviceConfig.playback.format = ma_format_f32;
+        // its own layout, so surround files play on every speaker there is
+        deviceConfig.playback.channels = 0;
+        // native rate, files are decoded straight to it so nothing gets resampled twice
+        deviceConfig.sampleRate = 0;
+        deviceConfig.periodSizeInFrames = static_cast<ma_uint32>(m_periodSize);
+        deviceConfig.performanceProfile =
+            m_latencyPreset == LowLatency ? ma_performance_profile_low_latency : ma_performance_profile_conservative;
+        deviceConfig.dataCallback = maDataCallback;
+        deviceConfig.pUserData = this;
+
+        if (ma_device_init(m_contextInit ? &m_context : nullptr, &deviceConfig, &m_device) != MA_SUCCESS)
+        {
+            qWarning() << "Failed to initialize MiniAudio device!";
+            return false;
+        }
+        if (m_device.playback.channels > MAX_DEVICE_CHANNELS)
+        {
+            // more than we stretch, miniaudio maps 7.1 onto it instead
+            ma_device_uninit(&m_device);
+            deviceConfig.playback.channels = MAX_DEVICE_CHANNELS;
+            if (ma_device_init(m_contextInit ? &m_context : nullptr, &deviceConfig, &m_device) != MA_SUCCESS)
+            {
+                qWarning() << "Failed to initialize MiniAudio device!";
+                return false;
+            }
+        }
+        m_deviceInit = true;
+        m_sampleRate = static_cast<int>(m_device.sampleRate);
+        m_channels = static_cast<int>(m_device.playback.channels);
+
+        // frames the device buffers after each callback, at our rate
+        m_callback.deviceLatency = static_cast<std::uint64_t>(m_device.playback.internalPeriodSizeInFrames) *
+                                   m_device.playback.internalPeriods * m_device.sampleRate /
+                                   std::max<ma_uint32>(m_device.playback.internalSampleRate, 1);
+
+        return initRingBuffer();
+    }};
+
+    const bool opened{open()};
+    initWorkerThread();
+
+    Q_EMIT deviceChanged();
+    return opened;
+}
+
+bool Player::initHeadless(const int sampleRate, const int channels)
+{
+    stopWorkerThread();
+
+    if (m_deviceInit)
+    {
+        ma_device_uninit(&m_device);
+        m_deviceInit = false;
+    }
+
+    if (m_rbInit)
+    {
+        ma_pcm_rb_uninit(&m_ringBuffer);
+        m_rbInit = false;
+    }
+
+    // whoever calls maDataCallback is the device, and it keeps no buffer of its own
+    m_sampleRate = sampleRate;
+    m_channels = std::clamp(channels, 1, MAX_DEVICE_CHANNELS);
+    m_callback.deviceLatency = 0;
+
+    const bool initialised{initRingBuffer()};
+    initWorkerThread();
+
+    Q_EMIT deviceChanged();
+    return initialised;
+}
+
+bool Player::initRingBuffer()
+{
+    if (ma_pcm_rb_init(
+            ma_format_f32,
+            static_cast<ma_uint32>(m_channels),
+            static_cast<ma_uint32>(m_periodSize * m_bufferPeriods),
+            nullptr,
+            nullptr,
+            &m_ringBuffer) != MA_SUCCESS)
+    {
+        qWarning() << "Failed to initialize ring buffer!";
+        return false;
+    }
+    m_rbInit = true;
+    m_ringWritten = 0;
+    m_ringRead.store(0);
+    m_ringDiscardUntil.store(0);
+    m_timeline.clear();
+    // the callback's copy, m_periodSize changes before the device is stopped
+    m_callback.refillFrames = static_cast<std::uint32_t>(m_periodSize);
+    m_callback.primed = false;
+
+    // the worker isn't running, so it can't be halfway through a quality switch
+    m_activeStretcher = 0;
+    m_blockQuality = m_activeQuality;
+    m_fading = false;
+    configureStretcher(m_stretchers[m_activeStretcher], m_blockQuality);
+    initBuffers();
+    return true;
+}
+
+void Player::restartDevice()
+{
+    if (!m_deviceInit)
+    {
+        // picked up when the next file is loaded
+        return;
+    }
+
+    const bool wasPlaying{m_playing.load()};
+    const float position{m_position};
+    const int sampleRate{m_sampleRate};
+    const int channels{m_channels};
+
+    pause();
+    if (!initDevice())
+    {
+        return;
+    }
+
+    if ((m_sampleRate != sampleRate || m_channels != channels) && !m_loadedFile.isEmpty())
+    {
+        // the decoded PCM is at the old device's rate, and mixed for its speakers
+        loadFile(m_loadedFile);
+    }
+    setPosition(position);
+
+    if (wasPlaying)
+    {
+        play();
+    }
+}
+
+void Player::refreshDevices()
+{
+    if (!m_contextInit)
+    {
+        return;
+    }
+
+    ma_device_info* playbackInfos;
+    ma_uint32 playbackCount;
+    if (ma_context_get_devices(&m_context, &playbackInfos, &playbackCount, nullptr, nullptr) != MA_SUCCESS)
+    {
+        qWarning() << "Failed to enumerate playback devices!";
+        return;
+    }
+
+    const QString selected{m_outputDevice >= 0 ? m_deviceNames.value(m_outputDevice) : QString{}};
+
+    m_deviceIds.clear();
+    m_deviceNames.clear();
+    for (ma_uint32 i{0}; i < playbackCount; ++i)
+    {
+        m_deviceIds.push_back(playbackInfos[i].id);
+        m_deviceNames.append(QString::fromUtf8(playbackInfos[i].name));
+    }
+    Q_EMIT outputDevicesChanged();
+
+    // the open device stays open, a device that has disappeared just isn't selected anymore
+    const int index{selected.isEmpty() ? -1 : static_cast<int>(m_deviceNames.indexOf(selected))};
+    if (index != m_outputDevice)
+    {
+        m_outputDevice = index;
+        Q_EMIT outputDeviceChanged();
+    }
+}
+
+void Player::setOutputDevice(int index)
+{
+    index = std::clamp(index, -1, static_cast<int>(m_deviceNames.size()) - 1);
+    if (m_outputDevice != index)
+    {
+        m_outputDevice = index;
+        Q_EMIT outputDeviceChanged();
+        restartDevice();
+    }
+}
+
+void Player::setPeriodSize(int frames)
+{
+    frames = std::clamp(frames, MIN_PERIOD_SIZE, MAX_PERIOD_SIZE);
+    if (m_periodSize != frames)
+    {
+        m_periodSize = frames;
+        Q_EMIT periodSizeChanged();
+        updateLatencyPreset();
+        restartDevice();
+    }
+}
+
+void Player::setBufferPeriods(int periods)
 {
-    // stop processing before device is destroyed
-    m_processData.store(false);
-    if (m_processor.joinable())
+    periods = std::clamp(periods, MIN_BUFFER_PERIODS, MAX_BUFFER_PERIODS);
+    if (m_bufferPeriods != periods)
     {
-        m_processor.join();
+        m_bufferPeriods = periods;
+        Q_EMIT bufferPeriodsChanged();
+        updateLatencyPreset();
+        restartDevice();
     }
+}
 
-    if (m_deviceInit)
+void Player::setLatencyPreset(const LatencyPreset preset)
+{
+    if (m_latencyPreset == preset)
     {
-        ma_device_uninit(&m_device);
+        return;
     }
 
-    if (m_converterInit)
+    m_latencyPreset = preset;
+    Q_EMIT latencyPresetChanged();
+    if (preset == Custom)
     {
-        ma_data_converter_uninit(&m_converter, nullptr);
+        return;
     }
 
-    if (m_rbInit)
+    // both settings change at once, so the device only restarts once
+    const LatencySettings& settings{s_latencyPresets[preset]};
+    if (m_periodSize != settings.periodSize)
     {
-        ma_pcm_rb_uninit(&m_ringBuffer);
+        m_periodSize = settings.periodSize;
+        Q_EMIT periodSizeChanged();
+    }
+    if (m_bufferPeriods != settings.bufferPeriods)
+    {
+        m_bufferPeriods = settings.bufferPeriods;
+        Q_EMIT bufferPeriodsChanged();
     }
+    restartDevice();
 }
 
-void Player::setFilePath(const QString& path)
+void Player::updateLatencyPreset()
 {
-    if (m_filePath != path)
+    LatencyPreset preset{Custom};
+    for (int i{0}; i < static_cast<int>(s_latencyPresets.size()); ++i)
     {
-        m_filePath = path;
-        Q_EMIT filePathChanged();
+        if (s_latencyPresets[i].periodSize == m_periodSize && s_latencyPresets[i].bufferPeriods == m_bufferPeriods)
+        {
+            preset = static_cast<LatencyPreset>(i);
+        }
     }
-}
 
-void Player::stopPlaybackCallback() { Q_EMIT signalStop(); }
+    if (m_latencyPreset != preset)
+    {
+        m_latencyPreset = preset;
+        Q_EMIT latencyPresetChanged();
+    }
+}
 
-void Player::updatePositionCallback() { Q_EMIT signalPositionUpdate(); }
+float Player::bufferLatency() const
+{
+    return 1000.0f * static_cast<float>(m_periodSize * m_bufferPeriods) / static_cast<float>(m_sampleRate);
+}
 
-void Player::handleStop() { pause(); }
+void Player::setStretchQuality(const StretchQuality quality)
+{
+    if (m_stretchQuality != quality)
+    {
+        m_stretchQuality = quality;
+        // the governor starts over from here
+        m_calmIntervals = 0;
+        setActiveQuality(quality);
+        Q_EMIT stretchQualityChanged();
+    }
+}
 
-void Player::updatePosition()
+void Player::setAdaptiveQuality(const bool adaptive)
 {
-    float pos{static_cast<float>(m_frameCount.load()) / static_cast<float>(m_sampleRate)};
-    if (std::abs(pos - m_position) > 0.05f)
+    if (m_adaptiveQuality != adaptive)
     {
-        m_position = pos;
-        if (m_position >= m_duration)
+        m_adaptiveQuality = adaptive;
+        m_calmIntervals = 0;
+        m_governorCooldown = 0;
+        if (!adaptive)
         {
-            m_position = m_duration;
-            stopPlaybackCallback();
+            setActiveQuality(m_stretchQuality);
         }
-        Q_EMIT positionChanged();
+        Q_EMIT adaptiveQualityChanged();
     }
 }
 
-void Player::setPosition(float seconds)
+void Player::setActiveQuality(const StretchQuality quality)
 {
-    const bool playing{m_playing.load()};
-    m_playing.store(false); // stop processing data
-
-    if (m_rbInit)
+    if (m_activeQuality != quality)
     {
-        // flush ring buffer
-        ma_pcm_rb_reset(&m_ringBuffer);
-    }
+        m_activeQuality = quality;
 
-    seconds = std::clamp(seconds, 0.0f, m_duration);
+        // the worker crossfades to it over its next block
+        Command command{Command::Type::Quality};
+        command.quality = quality;
+        pushCommand(command);
 
-    long targetIndex{static_cast<long>(seconds * static_cast<float>(m_channels) * static_cast<float>(m_sampleRate))};
-    targetIndex -= (targetIndex % m_channels);
-    m_readIndex.store(
-        static_cast<std::size_t>(std::clamp<long>(targetIndex, 0, static_cast<long>(m_pcmBuffer.size()))));
+        Q_EMIT activeQualityChanged();
+    }
+}
 
-    m_frameCount.store(static_cast<std::size_t>(seconds * static_cast<float>(m_sampleRate)));
+void Player::governQuality(const float peakLoad, const std::uint32_t minFill, const bool underrun)
+{
+    // the switch itself shows up in the stats, that's not what we're after
+    if (m_governorCooldown > 0)
+    {
+        --m_governorCooldown;
+        return;
+    }
 
-    m_position = seconds;
-    m_stretcher.reset();
+    const bool pressure{
+        peakLoad > GOVERNOR_DOWN_LOAD || minFill < static_cast<std::uint32_t>(m_periodSize / 2) || underrun};
+    if (pressure)
+    {
+        m_calmIntervals = 0;
+        if (m_activeQuality > CheaperQuality)
+        {
+            setActiveQuality(static_cast<StretchQuality>(m_activeQuality - 1));
+            m_governorCooldown = 2;
+        }
+        return;
+    }
 
-    if (m_deviceInit && m_converterInit)
+    // well below where it stepped down, for a while, so it doesn't go straight back down again
+    m_calmIntervals = peakLoad < GOVERNOR_UP_LOAD ? m_calmIntervals + 1 : 0;
+    if (m_calmIntervals >= GOVERNOR_UP_INTERVALS && m_activeQuality < m_stretchQuality)
     {
-        ma_data_converter_reset(&m_converter);
+        setActiveQuality(static_cast<StretchQuality>(m_activeQuality + 1));
+        m_calmIntervals = 0;
+        m_governorCooldown = 2;
     }
+}
 
-    m_playing.store(playing);
+void Player::setLoopStart(const float seconds)
+{
+    setLoop(seconds, m_loopEnd);
+}
 
-    Q_EMIT positionChanged();
+void Player::setLoopEnd(const float seconds)
+{
+    setLoop(m_loopStart, seconds);
 }
 
-void Player::play()
+void Player::setLoop(const float startSeconds, const float endSeconds)
 {
-    if (!m_playing)
+    const float start{std::clamp(startSeconds, 0.0f, m_duration)};
+    const float end{std::clamp(endSeconds, 0.0f, m_duration)};
+    if (start != m_loopStart || end != m_loopEnd)
     {
-        m_playing = true;
-        Q_EMIT playingChanged();
-        if (m_deviceInit)
-        {
-            ma_device_start(&m_device);
-        }
+        m_loopStart = start;
+        m_loopEnd = end;
+        updateLoop();
+        Q_EMIT loopChanged();
     }
 }
 
-void Player::pause()
+void Player::setLooping(const bool looping)
 {
-    if (m_playing)
+    if (m_looping != looping)
     {
-        m_playing = false;
-        Q_EMIT playingChanged();
-        if (m_deviceInit)
-        {
-            ma_device_stop(&m_device);
-        }
+        m_looping = looping;
+        updateLoop();
+        Q_EMIT loopChanged();
     }
 }
 
-void Player::setSpeed(const float t)
+std::pair<std::size_t, std::size_t> Player::loopFrames() const
 {
-    m_speed.store(std::clamp(t, MIN_SPEED, MAX_SPEED));
-    /*if (m_rbInit)
+    const std::size_t start{static_cast<std::size_t>(m_loopStart * static_cast<float>(m_sampleRate))};
+    const std::size_t end{static_cast<std::size_t>(m_loopEnd * static_cast<float>(m_sampleRate))};
+    if (!m_looping || end < start + LoopCache::minimumFrames(m_sampleRate, speed()))
     {
-        ma_pcm_rb_reset(&m_ringBuffer);
-    }*/
-    Q_EMIT speedChanged();
+        return {0, 0};
+    }
+    return {start, end};
 }
 
-void Player::loadFile(const QUrl& fileUrl)
+void Player::updateLoop()
 {
-    pause();
-    setPosition(0);
+    const auto [start, end]{loopFrames()};
 
-    QString filePath{fileUrl.toLocalFile()};
-    AVFormatContext* formatContext{nullptr};
-    int ret{avformat_open_input(&formatContext, filePath.toStdString().c_str(), nullptr, nullptr)};
-    if (ret < 0)
-    {
-        qWarning() << "ERROR decoding media: Failed to open file: `" << filePath << "`!";
-        return;
-    }
+    Command command{Command::Type::Loop};
+    command.frame = start;
+    command.end = end;
+    pushCommand(command);
 
-    ret = avformat_find_stream_info(formatContext, nullptr);
-    if (ret < 0)
+    // meanwhile it's stretched live, and the worker switches over at the next wrap once it's there
+    setLoopReady(end > 0 && m_loopCache.find(start, end, speed()));
+    if (end > 0 && !m_loopReady)
     {
-        qWarning() << "ERROR decoding media: Failed to find stream info!";
-        avformat_close_input(&formatContext);
-        return;
+        m_loopRenderTimer.start();
     }
+}
 
-    int streamIndex{av_find_best_stream(formatContext, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0)};
-    if (streamIndex < 0)
+void Player::renderLoop()
+{
+    const auto [start, end]{loopFrames()};
+    const std::shared_ptr<SampleStore> store{getSampleStore()};
+    const float speed{m_speed.load()};
+    if (end == 0 || !store || !m_decodeFinished || m_loopCache.find(start, end, speed))
     {
-        qWarning() << "ERROR decoding media: No audio stream found in `" << filePath << "`";
-        avformat_close_input(&formatContext);
         return;
     }
 
-    const AVStream* stream{formatContext->streams[streamIndex]};
-    const AVCodec* avDecoder{avcodec_find_decoder(stream->codecpar->codec_id)};
-    if (!avDecoder)
+    // only ever one at a time, the newest range and speed win
+    stopLoopRender();
+    m_loopRendering.store(true);
+    m_loopRenderer = std::thread(
+        [this, store, start, end, speed, sampleRate = m_sampleRate, channels = m_channels]()
+        {
+            std::shared_ptr<const LoopCache::Loop> loop{
+                m_loopCache.render(*store, sampleRate, channels, start, end, speed, m_loopRendering)};
+            if (loop)
+            {
+                m_loopCache.insert(std::move(loop));
+                Q_EMIT signalLoopRendered();
+            }
+        });
+}
+
+void Player::stopLoopRender()
+{
+    m_loopRendering.store(false);
+    if (m_loopRenderer.joinable())
     {
-        qWarning() << "ERROR decoding media: no decoder found!";
-        avformat_close_input(&formatContext);
-        return;
+        m_loopRenderer.join();
     }
+}
 
-    AVCodecContext* decoderCtx{avcodec_alloc_context3(avDecoder)};
-    avcodec_parameters_to_context(decoderCtx, stream->codecpar);
+void Player::handleLoopRendered()
+{
+    // may be for a range or speed that has changed since
+    const auto [start, end]{loopFrames()};
+    setLoopReady(end > 0 && m_loopCache.find(start, end, speed()));
+}
 
-    ret = avcodec_open2(decoderCtx, avDecoder, nullptr);
-    if (ret < 0)
+void Player::setLoopReady(const bool ready)
+{
+    if (m_loopReady != ready)
     {
-        qWarning() << "ERROR decoding media: failed to open decoder!";
-        return;
+        m_loopReady = ready;
+        Q_EMIT loopReadyChanged();
     }
+}
 
-    m_sampleRate = decoderCtx->sample_rate;
-    m_channels = decoderCtx->ch_layout.nb_channels;
-
-    AVChannelLayout inChannelLayout{decoderCtx->ch_layout};
-    if (inChannelLayout.order == AV_CHANNEL_ORDER_UNSPEC || inChannelLayout.nb_channels == 0)
+void Player::updateStats()
+{
+    const PlaybackStats::Totals totals{m_stats.totals()};
+    // load is how much of a block's playing time the worker needed to make it, over the last interval
+    const std::uint64_t busy{totals.busyNs - m_lastTotals.busyNs};
+    const std::uint64_t deadline{totals.deadlineNs - m_lastTotals.deadlineNs};
+    const double load{deadline > 0 ? static_cast<double>(busy) / static_cast<double>(deadline) : 0.0};
+    const double capacity{static_cast<double>(std::max(m_periodSize * m_bufferPeriods, 1))};
+
+    const std::uint32_t minFill{m_stats.takeMinFill()};
+    const float peakLoad{m_stats.takePeakLoad()};
+
+    QVariantList histogram{};
+    for (const std::uint64_t count : totals.histogram)
     {
-        av_channel_layout_default(&inChannelLayout, m_channels);
+        histogram.append(static_cast<qulonglong>(count));
     }
-    else
+
+    m_statsMap = {
+        {"speed", speed()},
+        {"periodSize", m_periodSize},
+        {"underruns", static_cast<qulonglong>(totals.underruns)},
+        {"silentFrames", static_cast<qulonglong>(totals.silentFrames)},
+        {"shortWrites", static_cast<qulonglong>(totals.shortWrites)},
+        {"droppedFrames", static_cast<qulonglong>(totals.droppedFrames)},
+        {"timelineDrops", static_cast<qulonglong>(totals.timelineDrops)},
+        {"fill", static_cast<double>(m_stats.fill()) / capacity},
+        {"minFill", static_cast<double>(minFill) / capacity},
+        {"load", load},
+        {"peakLoad", static_cast<double>(peakLoad)},
+        {"headroom", 1.0 - load},
+        // block time in steps of PlaybackStats::s_bucketWidth deadlines, since the player was created
+        {"loadHistogram", histogram},
+        {"loadBucketWidth", PlaybackStats::s_bucketWidth},
+        {"quality", static_cast<int>(m_activeQuality)}};
+
+    // only judged on intervals that actually played something
+    if (m_adaptiveQuality && m_playing && totals.blocks > m_lastTotals.blocks)
     {
-        av_channel_layout_copy(&inChannelLayout, &decoderCtx->ch_layout);
+        governQuality(peakLoad, minFill, totals.underruns > m_lastTotals.underruns);
     }
+    m_lastTotals = totals;
+    Q_EMIT statsChanged();
 
-    AVChannelLayout outChannelLayout;
-    av_channel_layout_default(&outChannelLayout, m_channels);
-
-    AVPacket* packet{av_packet_alloc()};
-    AVFrame* frame{av_frame_alloc()};
-
-    SwrContext* swrContext{swr_alloc()};
-    ret = swr_alloc_set_opts2(
-        &swrContext,
-        &outChannelLayout,
-        AV_SAMPLE_FMT_FLT,
-        m_sampleRate,
-        &inChannelLayout,
-        decoderCtx->sample_fmt,
-        m_sampleRate,
-        0,
-        nullptr);
-
-    if (ret < 0 || !swrContext)
+    if (m_statsLog.isOpen())
     {
-        qWarning() << "ERROR decoding media: Failed to allocate SwrContext options!";
-        av_packet_free(&packet);
-        av_frame_free(&frame);
-        avformat_close_input(&formatContext);
-        return;
+        QJsonObject line{QJsonObject::fromVariantMap(m_statsMap)};
+        line.insert("time", QDateTime::currentMSecsSinceEpoch());
+        m_statsLog.write(QJsonDocument{line}.toJson(QJsonDocument::Compact) + '\n');
+        m_statsLog.flush();
     }
+}
 
-    ret = swr_init(swrContext);
-    if (ret < 0)
+void Player::cancelLoad()
+{
+    if (!m_loading)
     {
-        qWarning() << "ERROR decoding media: swr_init() failed!";
-        swr_free(&swrContext);
-        av_packet_free(&packet);
-        av_frame_free(&frame);
-        avformat_close_input(&formatContext);
         return;
     }
 
-    av_channel_layout_uninit(&inChannelLayout);
-    av_channel_layout_uninit(&outChannelLayout);
+    // whatever has been decoded so far stays playable
+    stopDecoder();
+    handleDecodeProgress();
+}
 
-    m_pcmBuffer.clear();
-    // preallocate memory if possible to prevent vector resizing too much
-    if (formatContext->duration != AV_NOPTS_VALUE)
-    {
-        double durationSec{static_cast<double>(formatContext->duration) / static_cast<double>(AV_TIME_BASE)};
-        m_pcmBuffer.reserve(static_cast<std::size_t>(durationSec * m_sampleRate * m_channels));
-    }
+void Player::decodePCM(
+    const QString filePath,
+    const SampleStore::Format format,
+    const int deviceRate,
+    const int deviceChannels)
+{
+    std::shared_ptr<SampleStore> store{};
+    std::shared_ptr<PeakPyramid> pyramid{};
+    float estimatedDuration{0.0f};
 
-    while (av_read_frame(formatContext, packet) >= 0)
+    const auto publish{[&]()
     {
-        if (packet->stream_index != streamIndex)
-            continue;
+        // waveform for everything decoded since the last update
+        pyramid->build(*store);
 
-        ret = avcodec_send_packet(decoderCtx, packet);
-        if (ret < 0 && (ret != AVERROR(EAGAIN)))
+        const float decoded{static_cast<float>(store->frames()) / static_cast<float>(deviceRate)};
         {
-            qWarning() << "Failed to decode frame!";
-            continue;
+            std::lock_guard lock{m_progressMutex};
+            m_pendingProgress.estimatedDuration = estimatedDuration;
+            m_pendingProgress.progress =
+                store->finished() ? 1.0f
+                                   : (estimatedDuration > 0.0f ? std::min(decoded / estimatedDuration, 0.99f) : 0.0f);
         }
+        Q_EMIT signalDecodeProgress();
+    }};
 
-        while (avcodec_receive_frame(decoderCtx, frame) >= 0)
-        {
-            int maxSamples{swr_get_out_samples(swrContext, frame->nb_samples)};
-            std::vector<float> tempBuffer(maxSamples * m_channels);
+    const auto started{[&](const std::shared_ptr<SampleStore>& newStore, const Decoder::Stream& stream)
+    {
+        store = newStore;
+        pyramid = std::make_shared<PeakPyramid>(store->channels());
+        estimatedDuration = stream.estimatedDuration;
+        setSampleStore(store, pyramid);
+    }};
+
+    auto lastUpdate{std::chrono::steady_clock::now()};
+    bool firstUpdate{true};
+    const auto decoded{[&]()
+    {
+        m_workerWake.signal();
 
-            uint8_t* data{reinterpret_cast<uint8_t*>(tempBuffer.data())};
-            int outSamples{swr_convert(swrContext, &data, maxSamples, (const uint8_t**)frame->data, frame->nb_samples)};
-            if (outSamples > 0)
-            {
-                m_pcmBuffer.insert(
-                    m_pcmBuffer.end(), tempBuffer.begin(), tempBuffer.begin() + (outSamples * m_channels));
-            }
+        // keep the UI up to date without flooding the event loop
+        const auto now{std::chrono::steady_clock::now()};
+        if (firstUpdate || now - lastUpdate >= std::chrono::milliseconds(100))
+        {
+            publish();
+            lastUpdate = now;
+            firstUpdate = false;
         }
+    }};
 
-        av_packet_unref(packet);
-    }
-
-    // tidy up
-    av_packet_free(&packet);
-    av_frame_free(&frame);
-    swr_free(&swrContext);
-    avcodec_free_context(&decoderCtx);
-    avformat_close_input(&formatContext);
+    bool complete{false};
+    Decoder::decodeParallel(filePath, format, deviceRate, deviceChannels, m_decodeData, started, decoded, &complete);
 
-    const bool convert{convertPCM(m_sampleRate, m_channels) < 0};
-
-    m_readIndex = 0;
-    m_duration = static_cast<float>(m_pcmBuffer.size()) / m_sampleRate / m_channels;
-    m_position = 0.0f;
+    // there always has to be a finished store once decoding stops, even if it's empty
+    if (!store)
+    {
+        store = SampleStore::create(format, deviceChannels);
+        pyramid = std::make_shared<PeakPyramid>(store->channels());
+        setSampleStore(store, pyramid);
+    }
 
-    Q_EMIT durationChanged();
-    Q_EMIT positionChanged();
+    store->finish();
+    // the worker may be waiting for frames that will never come
+    m_workerWake.signal();
+    publish();
 
-    if (!m_rbInit)
+    // only fully decoded files are worth caching
+    if (complete && store->frames() > 0)
     {
-        if (ma_pcm_rb_init(ma_format_f32, DEVICE_CHANNELS, MAX_FRAMES * 4, nullptr, nullptr, &m_ringBuffer) !=
-            MA_SUCCESS)
+        if (!PCMCache::store(filePath, *store, deviceRate, deviceChannels, *pyramid, m_decodeData) &&
+            m_decodeData.load())
         {
-            qWarning() << "Failed to initialize ring buffer!";
-            return;
+            qWarning() << "Failed to write PCM cache for `" << filePath << "`";
         }
-        m_rbInit = true;
+        PCMCache::evict(PCM_CACHE_MAX_BYTES);
     }
-    ma_pcm_rb_reset(&m_ringBuffer);
+}
 
-    if (!m_deviceInit)
+void Player::streamPCM(const QString filePath, const int deviceRate, const int deviceChannels)
+{
+    const std::shared_ptr<StreamedStore> store{
+        StreamedStore::open(filePath, deviceRate, deviceChannels, m_decodeData)};
+    if (!store)
     {
-        ma_device_config deviceConfig{ma_device_config_init(ma_device_type_playback)};
-        deviceConfig.playback.format = ma_format_f32;
-        // fix audio settings so always good quality
-        deviceConfig.playback.channels = DEVICE_CHANNELS;
-        deviceConfig.sampleRate = DEVICE_SAMPLERATE;
-        deviceConfig.dataCallback = maDataCallback;
-        deviceConfig.periodSizeInFrames = MAX_FRAMES;
-        deviceConfig.pUserData = this;
-
-        if (ma_device_init(nullptr, &deviceConfig, &m_device) != MA_SUCCESS)
+        // no length to stream by (or nothing to decode at all, which decodePCM() reports the same way)
+        if (m_decodeData.load())
         {
-            qWarning() << "Failed to initialize MiniAudio device!";
-            return;
+            decodePCM(filePath, SampleStore::Format::Float, deviceRate, deviceChannels);
         }
-        else
+        return;
+    }
+
+    // every frame can be played as soon as the header has been read, the load lasts until the waveform is done
+    const std::size_t total{store->frames()};
+    const std::shared_ptr<PeakPyramid> pyramid{std::make_shared<PeakPyramid>(
+        store->channels(),
+        PeakPyramid::baseFramesFor(total, store->channels(), STREAM_PEAK_BYTES))};
+    const auto publish{[&](const std::size_t built, const bool waveform)
+    {
         {
-            m_deviceInit = true;
+            std::lock_guard lock{m_progressMutex};
+            m_pendingProgress.estimatedDuration = static_cast<float>(total) / static_cast<float>(deviceRate);
+            m_pendingProgress.progress =
+                waveform ? std::min(static_cast<float>(built) / static_cast<float>(total), 0.99f) : 1.0f;
+            m_pendingProgress.waveform = waveform;
         }
-
-        m_stretcher.presetDefault(m_channels, m_sampleRate);
-        initBuffers();
+        Q_EMIT signalDecodeProgress();
+    }};
+    {
+        std::lock_guard lock{m_progressMutex};
+        m_pendingProgress.waveform = true;
     }
-    m_stretcher.reset();
-    m_frameCount.store(0);
-
-    // for displaying PCM data
-    desamplePCM();
-
-    if (m_deviceInit && convert)
+    setSampleStore(store, pyramid);
+    publish(0, true);
+
+    // the waveform needs every sample once, they are thrown away again straight after
+    const std::unique_ptr<SeekableDecoder> decoder{
+        SeekableDecoder::open(filePath, deviceRate, deviceChannels, m_decodeData, store->index())};
+    // whole peaks at a time, both are powers of two
+    const std::size_t step{std::max(StreamedStore::s_blockFrames, pyramid->baseFrames())};
+    std::vector<float> scratch(step * store->channels());
+    std::size_t built{0};
+    auto lastUpdate{std::chrono::steady_clock::now()};
+    while (decoder && m_decodeData.load())
     {
-        if (m_converterInit)
+        const std::size_t read{decoder->read(scratch.data(), step)};
+        pyramid->append(scratch.data(), read);
+        built += read;
+        if (read < step)
         {
-            ma_data_converter_uninit(&m_converter, nullptr);
-            m_converterInit = false;
+            break;
         }
 
-        if (m_sampleRate != DEVICE_SAMPLERATE || m_channels != DEVICE_CHANNELS)
+        const auto now{std::chrono::steady_clock::now()};
+        if (now - lastUpdate >= std::chrono::milliseconds(100))
         {
-            qWarning() << "Input audio stream differs from device sample rate and channels...";
-            qWarning() << "Setting up ma_data_converter (" << static_cast<float>(m_sampleRate) * 0.001f << "kHz => "
-                       << static_cast<float>(DEVICE_SAMPLERATE) * 0.001f << "kHz, " << m_channels << " channels => "
-                       << DEVICE_CHANNELS << " channels)";
-            m_converterInit = true;
-            ma_data_converter_config converterConfig{ma_data_converter_config_init(
-                ma_format_f32, ma_format_f32, m_channels, DEVICE_CHANNELS, m_sampleRate, DEVICE_SAMPLERATE)};
-
-            if (ma_data_converter_init(&converterConfig, nullptr, &m_converter) != MA_SUCCESS)
-            {
-                qWarning() << "Failed to initialize data converter!";
-                m_converterInit = false;
-                return;
-            }
+            publish(built, true);
+            lastUpdate = now;
         }
     }
+
+    // cancelled or not, whatever has been built so far is all the waveform there is
+    publish(built, false);
 }
 
-void Player::initBuffers()
+void Player::stopDecoder()
 {
-    const std::size_t maxInputFrames{static_cast<std::size_t>(MAX_FRAMES * MAX_SPEED * 1.2f)};
-    m_inputBuffer[0].resize(maxInputFrames);
-    m_inputBuffer[1].resize(maxInputFrames);
-
-    constexpr std::size_t maxSize{MAX_FRAMES * static_cast<std::size_t>(1.0 / MIN_SPEED)};
-    m_outputBuffer[0].resize(maxSize * 1.2);
-    m_outputBuffer[1].resize(maxSize * 1.2);
+    m_decodeData.store(false);
+    if (m_decoder.joinable())
+    {
+        m_decoder.join();
+    }
 }
 
-int Player::convertPCM(const int sampleRate, const int channels)
+void Player::handleDecodeProgress()
 {
-    ma_data_converter converter;
-    ma_data_converter_config converterConfig{ma_data_converter_config_init(
-        ma_format_f32, ma_format_f32, channels, DEVICE_CHANNELS, sampleRate, DEVICE_SAMPLERATE)};
-    if (ma_data_converter_init(&converterConfig, nullptr, &converter) != MA_SUCCESS)
+    const std::shared_ptr<SampleStore> store{getSampleStore()};
+    if (!store)
     {
-        qWarning() << "Failed to initialize data converter!";
-        return -1;
+        return;
     }
 
-    const std::size_t totalFrames{m_pcmBuffer.size() / channels};
-
-    ma_uint64 bufferSize;
-    ma_data_converter_get_expected_output_frame_count(&converter, totalFrames, &bufferSize);
+    float progress;
+    bool waveform;
+    {
+        std::lock_guard lock{m_progressMutex};
+        m_estimatedDuration = m_pendingProgress.estimatedDuration;
+        progress = m_pendingProgress.progress;
+        waveform = m_pendingProgress.waveform;
+    }
 
-    std::vector<float> tempBuffer(bufferSize * DEVICE_CHANNELS);
+    const float decoded{static_cast<float>(store->frames()) / static_cast<float>(m_sampleRate)};
+    m_decodeFinished = store->finished();
+    // the container estimate can be off, so only trust it until decoding has finished
+    m_duration = m_decodeFinished ? decoded : std::max(decoded, m_estimatedDuration);
 
-    std::size_t inputIndex{0};
-    std::size_t writeIndex{0};
-    constexpr ma_uint64 stepSize{512};
+    Q_EMIT durationChanged();
+    Q_EMIT waveformChanged();
 
-    while (inputIndex < totalFrames)
+    if (progress != m_loadProgress)
     {
-        ma_uint64 framesIn{std::min(static_cast<ma_uint64>(totalFrames - inputIndex), stepSize)};
-        ma_uint64 framesOut{static_cast<ma_uint64>(bufferSize - writeIndex)};
-
-        const float* pInputData{m_pcmBuffer.data() + inputIndex * channels};
-        float* pOutputData{tempBuffer.data() + writeIndex * DEVICE_CHANNELS};
-
-        ma_data_converter_process_pcm_frames(&converter, pInputData, &framesIn, pOutputData, &framesOut);
+        m_loadProgress = progress;
+        Q_EMIT loadProgressChanged();
+    }
 
-        inputIndex += framesIn;
-        writeIndex += framesOut;
+    if (m_loading != (!m_decodeFinished || waveform))
+    {
+        m_loading = !m_loading;
+        Q_EMIT loadingChanged();
 
-        // if it's empty exit
-        if (framesIn == 0 && framesOut == 0)
+        // only finished stores get their loop rendered
+        if (!m_loading)
         {
-            break;
+            updateLoop();
         }
     }
+}
 
-    m_pcmBuffer.swap(tempBuffer);
-    tempBuffer.clear();
-
-    m_sampleRate = DEVICE_SAMPLERATE;
-    m_channels = DEVICE_CHANNELS;
-
-    ma_data_converter_uninit(&converter, nullptr);
-
-    return 0;
+void Player::initBuffers()
+{
+    // a block at full speed, or the pre-roll for a seek at the highest quality
+    const std::size_t maxInputFrames{std::max(
+        static_cast<std::size_t>(static_cast<float>(m_periodSize) * MAX_SPEED * 1.2f),
+        static_cast<std::size_t>((s_highQualityBlock + s_highQualityInterval) * static_cast<float>(m_sampleRate)) + 1)};
+    const std::size_t maxSize{static_cast<std::size_t>(m_periodSize) * static_cast<std::size_t>(1.0 / MIN_SPEED)};
+    for (int c{0}; c < m_channels; ++c)
+    {
+        m_inputBuffer[c].resize(maxInputFrames);
+        m_fadeBuffer[c].resize(m_periodSize);
+        m_outputBuffer[c].resize(maxSize * 1.2);
+    }
 }
 
 void processPCM(void* data)
@@ -484,137 +1430,266 @@ void processPCM(void* data)
         return;
 
     Player* player{static_cast<Player*>(data)};
+    // fixed while this thread runs, changing either restarts the thread
+    const ma_uint32 blockFrames{static_cast<ma_uint32>(player->m_periodSize)};
+    const int channels{player->m_channels};
+    // how long a block plays for, the most it may take to make one
+    const std::chrono::nanoseconds deadline{
+        static_cast<std::int64_t>(blockFrames) * 1000000000 / std::max(player->m_sampleRate, 1)};
+
+    // hands the next blockFrames frames of the ring buffer to write(out, offset, frames) in as many contiguous pieces
+    // as it takes (two where it wraps around), out is interleaved and offset counts from the start of the block
+    const auto writeRing{[player, blockFrames](const auto& write)
+    {
+        ma_uint32 written{0};
+        while (written < blockFrames)
+        {
+            void* pWriteBuffer;
+            ma_uint32 dataSize{blockFrames - written};
+            if (ma_pcm_rb_acquire_write(&player->m_ringBuffer, &dataSize, &pWriteBuffer) != MA_SUCCESS || dataSize == 0)
+            {
+                // only ever checked for a whole block first, so this means something is badly wrong
+                break;
+            }
+
+            write(static_cast<float*>(pWriteBuffer), written, dataSize);
+            ma_pcm_rb_commit_write(&player->m_ringBuffer, dataSize);
+            written += dataSize;
+        }
+
+        player->m_ringWritten += written;
+        if (written < blockFrames)
+        {
+            player->m_stats.shortWrite(blockFrames - written);
+        }
+    }};
+
+    // copies blockFrames planar frames to the ring buffer (silence if output is null)
+    const auto copyRing{[&writeRing, channels](const float* const* output)
+    {
+        writeRing(
+            [output, channels](float* out, const ma_uint32 offset, const ma_uint32 frames)
+            {
+                if (!output)
+                {
+                    Kernels::zero(out, frames * channels);
+                    return;
+                }
+                std::array<const float*, MAX_DEVICE_CHANNELS> from{};
+                for (int c{0}; c < channels; ++c)
+                {
+                    from[c] = output[c] + offset;
+                }
+                Kernels::interleave(from.data(), out, channels, frames);
+            });
+    }};
 
     while (player->m_processData.load())
     {
-        if (!player->m_playing.load())
+        // seeks and speed changes only ever land between blocks
+        player->applyCommands();
+
+        if (!player->m_playing.load() || !player->m_rbInit)
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(16));
+            // play() wakes us up again
+            player->m_workerWake.wait();
             continue;
         }
 
         ma_uint32 space{ma_pcm_rb_available_write(&player->m_ringBuffer)};
 
-        if (space >= MAX_FRAMES)
+        if (space >= blockFrames)
         {
+            const std::shared_ptr<SampleStore> store{player->getSampleStore()};
+            if (!store)
+            {
+                // woken once the decoder has set up a store
+                player->m_workerWake.wait();
+                continue;
+            }
+
+            const float speed{player->m_blockSpeed};
+            const std::array<float*, MAX_DEVICE_CHANNELS> outputs{channelPointers(player->m_outputBuffer, channels)};
+
+            // a rendered loop is just copied, nothing to stretch
+            std::shared_ptr<const LoopCache::Loop> leaving{};
+            if (player->m_loop)
+            {
+                const LoopCache::Loop& loop{*player->m_loop};
+                if (loop.start == player->m_blockLoopStart && loop.end == player->m_blockLoopEnd && loop.speed == speed)
+                {
+                    const auto blockStart{std::chrono::steady_clock::now()};
+                    player->readLoop(loop, outputs.data(), blockFrames, player->m_ringWritten);
+                    copyRing(outputs.data());
+                    player->m_stats.block(std::chrono::steady_clock::now() - blockStart, deadline);
+                    continue;
+                }
+
+                // the loop or the speed changed, this block fades from the old loop to the live stretcher
+                leaving = player->m_loop;
+                player->leaveLoop(*store);
+            }
+
             const std::size_t currentReadIndex{player->m_readIndex.load()};
-            const float speed{player->m_speed.load()};
 
             // calculate frame io size
             const std::size_t inputFrames{
-                std::max<std::size_t>(static_cast<std::size_t>(static_cast<float>(MAX_FRAMES) * speed + 0.5f), 1)};
-            const std::size_t totalSize{player->m_pcmBuffer.size()};
+                std::max<std::size_t>(static_cast<std::size_t>(static_cast<float>(blockFrames) * speed + 0.5f), 1)};
+            const std::size_t totalFrames{store->frames()};
 
-            if (currentReadIndex > totalSize)
+            if (!store->finished() && currentReadIndex + inputFrames > totalFrames)
             {
-                // zero output
-                void* pWriteBuffer;
-                ma_uint32 dataSize{MAX_FRAMES};
-                ma_result result{ma_pcm_rb_acquire_write(&player->m_ringBuffer, &dataSize, &pWriteBuffer)};
-                if (result == MA_SUCCESS && dataSize != 0)
-                {
-                    float* chunk{static_cast<float*>(pWriteBuffer)};
-                    for (std::size_t i{0}; i < dataSize * DEVICE_CHANNELS; ++i)
-                    {
-                        chunk[i] = 0.0f;
-                    }
-                    ma_pcm_rb_commit_write(&player->m_ringBuffer, dataSize);
-                }
+                // decoder hasn't reached this part of the file yet, it wakes us up whenever it appends
+                player->m_workerWake.wait();
+                continue;
+            }
+
+            // the stretcher's latency gets flushed with silence before stopping
+            const double latency{player->blockLatency(speed)};
 
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            // past the end of the loop (or just got there), start over
+            const double blockSource{static_cast<double>(currentReadIndex) - latency};
+            if (player->m_blockLoopEnd > 0 && !leaving && blockSource >= static_cast<double>(player->m_blockLoopEnd))
+            {
+                player->wrapLoop(*store);
                 continue;
             }
-            const std::size_t availableSamples{currentReadIndex <= totalSize ? totalSize - currentReadIndex : 0};
-            const std::size_t frames{std::min(inputFrames, availableSamples)};
 
-            // make sure buffers' capacity is big enough
-            if (player->m_inputBuffer[0].size() < inputFrames)
+            if (static_cast<double>(currentReadIndex) > static_cast<double>(totalFrames) + latency)
             {
-                player->m_inputBuffer[0].resize(inputFrames);
-                player->m_inputBuffer[1].resize(inputFrames);
+                // zero output, parked on the last frame
+                player->pushTimeline(
+                    {player->m_ringWritten, static_cast<double>(totalFrames), 0.0f, player->m_blockSeek});
+                copyRing(nullptr);
+                player->m_workerWake.wait();
+                continue;
             }
 
-            if (player->m_outputBuffer[0].size() < MAX_FRAMES)
+            const auto blockStart{std::chrono::steady_clock::now()};
+
+            // make sure buffers' capacity is big enough
+            if (player->m_inputBuffer[0].size() < inputFrames)
             {
-                player->m_outputBuffer[0].resize(MAX_FRAMES);
-                player->m_outputBuffer[1].resize(MAX_FRAMES);
+                for (int c{0}; c < channels; ++c)
+                {
+                    player->m_inputBuffer[c].resize(inputFrames);
+                }
             }
 
-            // de-interleave data
-            for (std::size_t i{0}; i < inputFrames; ++i)
+            if (player->m_outputBuffer[0].size() < blockFrames)
             {
-                if (i < frames && currentReadIndex + i * DEVICE_CHANNELS + 1 < totalSize)
+                for (int c{0}; c < channels; ++c)
                 {
-                    player->m_inputBuffer[0][i] = player->m_pcmBuffer[currentReadIndex + i * DEVICE_CHANNELS];
-                    player->m_inputBuffer[1][i] = player->m_pcmBuffer[currentReadIndex + i * DEVICE_CHANNELS + 1];
-                    continue;
+                    player->m_outputBuffer[c].resize(blockFrames);
                 }
+            }
 
-                player->m_inputBuffer[0][i] = 0.0f;
-                player->m_inputBuffer[1][i] = 0.0f;
+            // de-interleave data, just the channels the store has (see stretchedChannels())
+            const int stretched{player->stretchedChannels(*store)};
+            const std::array<float*, MAX_DEVICE_CHANNELS> input{channelPointers(player->m_inputBuffer, stretched)};
+            const std::size_t frames{store->read(currentReadIndex, inputFrames, input.data(), stretched)};
+            for (int c{0}; c < stretched; ++c)
+            {
+                Kernels::zero(input[c] + frames, inputFrames - frames);
             }
 
-            player->m_stretcher.process(
-                player->m_inputBuffer.data(), inputFrames, player->m_outputBuffer.data(), MAX_FRAMES);
-            player->m_readIndex.store(currentReadIndex + frames * DEVICE_CHANNELS);
+            // the block's first output frame is the input from a latency ago
+            const float ratio{static_cast<float>(inputFrames) / static_cast<float>(blockFrames)};
+            const double source{static_cast<double>(currentReadIndex) - player->blockLatency(ratio)};
+            const bool crossesLoopEnd{
+                player->m_blockLoopEnd > 0 && source < static_cast<double>(player->m_blockLoopEnd) &&
+                source + static_cast<double>(inputFrames) > static_cast<double>(player->m_blockLoopEnd)};
 
-            // write processed data to ring buffer
-            void* pWriteBuffer;
-            ma_uint32 dataSize{MAX_FRAMES}; // NOTE: dataSize could be less than MAX_FRAMES
-            ma_result result{ma_pcm_rb_acquire_write(&player->m_ringBuffer, &dataSize, &pWriteBuffer)};
-            if (result != MA_SUCCESS || dataSize == 0)
+            if (!player->m_fading && !leaving && !crossesLoopEnd)
             {
-                // ring buffer is full
+                // nothing to blend, so the stretcher writes straight into the ring buffer
+                player->pushTimeline({player->m_ringWritten, source, ratio, player->m_blockSeek});
+                writeRing(
+                    [player, &input, stretched, inputFrames, blockFrames](
+                        float* out, const ma_uint32 offset, const ma_uint32 frames)
+                    {
+                        // input is split in proportion where the ring buffer wraps around
+                        const std::size_t from{inputFrames * offset / blockFrames};
+                        const std::size_t to{inputFrames * (offset + frames) / blockFrames};
+                        std::array<const float*, MAX_DEVICE_CHANNELS> in{};
+                        for (int c{0}; c < stretched; ++c)
+                        {
+                            in[c] = input[c] + from;
+                        }
+                        player->getStretcher().processInterleaved(
+                            in.data(), static_cast<int>(to - from), out, static_cast<int>(frames), stretched);
+                    });
+                player->m_readIndex.store(currentReadIndex + inputFrames);
+                player->m_stats.block(std::chrono::steady_clock::now() - blockStart, deadline);
                 continue;
             }
 
-            float* chunk{static_cast<float*>(pWriteBuffer)};
-            for (std::size_t i{0}; i < dataSize; ++i)
+            player->getStretcher().process(
+                input.data(), static_cast<int>(inputFrames), outputs.data(), static_cast<int>(blockFrames), stretched);
+            // past the end this reads on through silence
+            player->m_readIndex.store(currentReadIndex + inputFrames);
+
+            // a change of quality, the other stretcher takes over within this block
+            if (player->m_fading)
             {
-                chunk[i * 2] = player->m_outputBuffer[0][i];
-                chunk[i * 2 + 1] = player->m_outputBuffer[1][i];
+                player->crossfadeStretchers(*store, inputFrames, blockFrames);
             }
 
-            ma_pcm_rb_commit_write(&player->m_ringBuffer, dataSize);
+            player->pushTimeline({player->m_ringWritten, source, ratio, player->m_blockSeek});
+
+            const std::array<float*, MAX_DEVICE_CHANNELS> fade{channelPointers(player->m_fadeBuffer, channels)};
+            if (leaving)
+            {
+                // the loop carries on underneath while the live output fades in
+                player->readLoop(*leaving, fade.data(), blockFrames, std::nullopt);
+                crossfade(fade.data(), outputs.data(), outputs.data(), channels, blockFrames);
+            }
+            else if (crossesLoopEnd)
+            {
+                // the loop ends within this block, if it's been rendered its start takes over right there
+                player->m_loop =
+                    player->m_loopCache.find(player->m_blockLoopStart, player->m_blockLoopEnd, player->m_blockSpeed);
+                if (player->m_loop)
+                {
+                    const std::size_t live{std::min<std::size_t>(
+                        static_cast<std::size_t>((static_cast<double>(player->m_blockLoopEnd) - source) / ratio + 0.5),
+                        blockFrames)};
+                    player->m_loopOffset = 0;
+                    player->readLoop(
+                        *player->m_loop, fade.data(), blockFrames - live, player->m_ringWritten + live);
+
+                    // what the stretcher made past the end is the same audio as the rendered loop's fade
+                    const std::array<float*, MAX_DEVICE_CHANNELS> rest{
+                        channelPointers(player->m_outputBuffer, channels, live)};
+                    crossfade(rest.data(), fade.data(), rest.data(), channels, blockFrames - live);
+                }
+            }
+
+            // write processed data to ring buffer
+            copyRing(outputs.data());
+            player->m_stats.block(std::chrono::steady_clock::now() - blockStart, deadline);
         }
         else
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(6));
+            // maDataCallback wakes us up once a block fits again
+            player->m_workerWake.wait();
         }
     }
 }
 
-void Player::initWorkerThread() { m_processor = std::thread(processPCM, static_cast<void*>(this)); }
-
-// desample for visualisation (we don't need 48,000 samples per second being displayed)
-void Player::desamplePCM()
+void Player::initWorkerThread()
 {
-    m_displayBuffer.clear();
-    if (m_pcmBuffer.empty())
-    {
-        return;
-    }
+    m_processData.store(true);
+    m_processor = std::thread(processPCM, static_cast<void*>(this));
+}
 
-    const std::size_t stepSize{
-        static_cast<std::size_t>(m_sampleRate) / SAMPLE_DENSITY * static_cast<std::size_t>(m_channels)};
-    for (std::size_t i{0}; i < m_pcmBuffer.size(); i += stepSize)
+void Player::stopWorkerThread()
+{
+    m_processData.store(false);
+    m_workerWake.signal();
+    if (m_processor.joinable())
     {
-        // find the peak
-        float max{0.0f};
-        for (std::size_t j{0}; j < stepSize && (i + j) < m_pcmBuffer.size(); ++j)
-        {
-            max = std::max(max, std::abs(m_pcmBuffer[i + j]));
-        }
-        m_displayBuffer.append(max);
+        m_processor.join();
     }
-
-    Q_EMIT displayBufferChanged();
-
-    /*    const int numSamples{durationInSeconds() * SAMPLE_DENSITY * 2};
-        m_displayBuffer.resize(numSamples);
-        for (std::size_t i{0}; i < m_pcmBuffer.size() / 2; i += m_channels / SAMPLE_DENSITY)
-        {
-            m_displayBuffer.emplace_back(m_pcmBuffer[i * 2]);
-            m_displayBuffer.emplace_back(m_pcmBuffer[i * 2 + 1]);
-        }*/
 }
+
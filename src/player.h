@@ -3,26 +3,66 @@
 #ifndef SPEEDSHIFTER_PLAYER_H
 #define SPEEDSHIFTER_PLAYER_H
 
+#include <QFile>
 #include <QObject>
+#include <QStringList>
+#include <QTimer>
+#include <QUrl>
+#include <QVariantMap>
 #include <qqml.h>
 
 #include <miniaudio.h>
 #include <qtmetamacros.h>
-#include <signalsmith-stretch.h>
+
+#include "groupstretcher.h"
+#include "loopcache.h"
+#include "peakpyramid.h"
+#include "playbackstats.h"
+#include "samplestore.h"
+#include "seqlock.h"
+#include "spscqueue.h"
+#include "timeline.h"
+#include "wakeevent.h"
 
 #include <vector>
 #include <atomic>
 #include <array>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <thread>
+#include <utility>
 
-// Default: 48kHz stereo
+// Device is opened in its own channel layout (up to 7.1) at its native sample rate
+#define MAX_DEVICE_CHANNELS 8
+// only used until a device has been opened
 #define DEVICE_CHANNELS 2
+// only used until a device has been opened
 #define DEVICE_SAMPLERATE 48000
-#define MAX_FRAMES 1024
+
+// Frames per device period (also the block size the worker thread stretches), and ring buffer depth in periods
+#define DEFAULT_PERIOD_SIZE 1024
+#define MIN_PERIOD_SIZE 64
+#define MAX_PERIOD_SIZE 8192
+#define DEFAULT_BUFFER_PERIODS 4
+#define MIN_BUFFER_PERIODS 2
+#define MAX_BUFFER_PERIODS 16
 
 #define MIN_SPEED 0.2f
 #define MAX_SPEED 2.f
 #define SAMPLE_DENSITY 50
+// how often the playhead follows playback, in ms (about once per displayed frame)
+#define POSITION_INTERVAL 16
+// how often the playback stats are refreshed, in ms
+#define STATS_INTERVAL 500
+// adaptive quality steps down as soon as an interval's slowest block takes this much of its deadline (or the ring
+// buffer nearly ran dry), and back up after this many intervals in a row with every block below the lower mark
+#define GOVERNOR_DOWN_LOAD 0.8f
+#define GOVERNOR_UP_LOAD 0.4f
+#define GOVERNOR_UP_INTERVALS 10
+// an A-B loop is rendered once it and the speed haven't changed for this long, in ms
+#define LOOP_RENDER_DELAY 300
+
 
 class Player : public QObject
 {
@@ -33,6 +73,9 @@ class Player : public QObject
     Q_PROPERTY(float duration READ duration NOTIFY durationChanged)
     Q_PROPERTY(float speed READ speed WRITE setSpeed NOTIFY speedChanged)
     Q_PROPERTY(int durationInSeconds READ durationInSeconds)
+    Q_PROPERTY(bool loading READ loading NOTIFY loadingChanged)
+    Q_PROPERTY(float loadProgress READ loadProgress NOTIFY loadProgressChanged)
+    Q_PROPERTY(SampleStorage sampleStorage READ sampleStorage WRITE setSampleStorage NOTIFY sampleStorageChanged)
 
     static constexpr int s_sampleDensity{SAMPLE_DENSITY};
     static constexpr float s_minSpeed{MIN_SPEED};
@@ -41,11 +84,61 @@ class Player : public QObject
     Q_PROPERTY(float minSpeed MEMBER s_minSpeed CONSTANT)
     Q_PROPERTY(float maxSpeed MEMBER s_maxSpeed CONSTANT)
 
-    Q_PROPERTY(QList<float> displayBuffer READ displayBuffer NOTIFY displayBufferChanged)
+    // output device (index into outputDevices, -1 for the system default) and its settings
+    Q_PROPERTY(QStringList outputDevices READ outputDevices NOTIFY outputDevicesChanged)
+    Q_PROPERTY(int outputDevice READ outputDevice WRITE setOutputDevice NOTIFY outputDeviceChanged)
+    Q_PROPERTY(int sampleRate READ getSampleRate NOTIFY deviceChanged)
+    Q_PROPERTY(int periodSize READ periodSize WRITE setPeriodSize NOTIFY periodSizeChanged)
+    Q_PROPERTY(int bufferPeriods READ bufferPeriods WRITE setBufferPeriods NOTIFY bufferPeriodsChanged)
+    Q_PROPERTY(LatencyPreset latencyPreset READ latencyPreset WRITE setLatencyPreset NOTIFY latencyPresetChanged)
+    Q_PROPERTY(float bufferLatency READ bufferLatency NOTIFY deviceChanged)
+
+    // underruns, dropped frames, ring buffer fill and block timing (see updateStats())
+    Q_PROPERTY(QVariantMap stats READ stats NOTIFY statsChanged)
+
+    // chosen stretcher configuration, with adaptiveQuality the one in use may be lower while the CPU can't keep up
+    Q_PROPERTY(StretchQuality stretchQuality READ stretchQuality WRITE setStretchQuality NOTIFY stretchQualityChanged)
+    Q_PROPERTY(bool adaptiveQuality READ adaptiveQuality WRITE setAdaptiveQuality NOTIFY adaptiveQualityChanged)
+    Q_PROPERTY(StretchQuality activeQuality READ activeQuality NOTIFY activeQualityChanged)
+
+    // A-B loop in seconds, replayed from a pre-rendered buffer once loopReady (see LoopCache)
+    Q_PROPERTY(float loopStart READ loopStart WRITE setLoopStart NOTIFY loopChanged)
+    Q_PROPERTY(float loopEnd READ loopEnd WRITE setLoopEnd NOTIFY loopChanged)
+    Q_PROPERTY(bool looping READ looping WRITE setLooping NOTIFY loopChanged)
+    Q_PROPERTY(bool loopReady READ loopReady NOTIFY loopReadyChanged)
 
     QML_ELEMENT
 
 public:
+    // how decoded samples are held in memory, same order as SampleStore::Format
+    enum SampleStorage
+    {
+        Float,
+        Int16,
+        Packed,
+        Streamed // never decoded as a whole, blocks are decoded on demand (see StreamedStore)
+    };
+    Q_ENUM(SampleStorage)
+
+    // period size and ring buffer depth together
+    enum LatencyPreset
+    {
+        LowLatency, // 256 frames x 3
+        Balanced, // 1024 frames x 4
+        PowerSaving, // 4096 frames x 4
+        Custom
+    };
+    Q_ENUM(LatencyPreset)
+
+    // stretcher configuration, from cheapest to best sounding
+    enum StretchQuality
+    {
+        CheaperQuality, // signalsmith's cheaper preset
+        DefaultQuality, // its default preset
+        HighQuality // longer blocks with more overlap
+    };
+    Q_ENUM(StretchQuality)
+
     explicit Player(QObject* parent = nullptr);
     ~Player();
 
@@ -57,37 +150,72 @@ public:
     void setPosition(float seconds);
     [[nodiscard]] float duration() const { return m_duration; }
 
-    [[nodiscard]] std::vector<float>* getPCM_Buffer() { return &m_pcmBuffer; }
+    [[nodiscard]] std::shared_ptr<SampleStore> getSampleStore() const;
+    [[nodiscard]] std::shared_ptr<PeakPyramid> getPeakPyramid() const;
     [[nodiscard]] std::atomic<std::size_t>& getReadIndex() { return m_readIndex; }
     [[nodiscard]] int getSampleRate() const { return m_sampleRate; }
     [[nodiscard]] int getChannels() const { return m_channels; }
 
-    [[nodiscard]] ma_data_converter* getConverter() { return &m_converter; }
-    [[nodiscard]] bool getConverterInit() const { return m_converterInit; }
-
     Q_INVOKABLE
     void play();
     Q_INVOKABLE
     void pause();
     Q_INVOKABLE
     void loadFile(const QUrl& fileUrl);
+    Q_INVOKABLE
+    void cancelLoad();
+
+    [[nodiscard]] bool loading() const { return m_loading; }
+    [[nodiscard]] float loadProgress() const { return m_loadProgress; }
 
-    // only get called from maDataCallback
-    void stopPlaybackCallback();
-    void updatePositionCallback();
+    [[nodiscard]] SampleStorage sampleStorage() const { return m_sampleStorage; }
+    // takes effect on the next load
+    void setSampleStorage(SampleStorage storage);
 
     [[nodiscard]] float speed() const { return m_speed.load(); };
     Q_INVOKABLE
     void setSpeed(float t);
 
-    [[nodiscard]] int durationInSeconds() const
+    [[nodiscard]] int durationInSeconds() const { return static_cast<int>(m_duration); }
+
+    [[nodiscard]] GroupStretcher& getStretcher()
     {
-        return static_cast<int>(m_pcmBuffer.size()) / m_channels / m_sampleRate;
+        return m_stretchers[m_activeStretcher];
     }
 
-    [[nodiscard]] QList<float> displayBuffer() const { return m_displayBuffer; }
-
-    [[nodiscard]] signalsmith::stretch::SignalsmithStretch<float>& getStretcher() { return m_stretcher; }
+    [[nodiscard]] QStringList outputDevices() const { return m_deviceNames; }
+    // re-enumerates the playback devices, keeps the selected one if it's still there
+    Q_INVOKABLE
+    void refreshDevices();
+    [[nodiscard]] int outputDevice() const { return m_outputDevice; }
+    void setOutputDevice(int index);
+
+    [[nodiscard]] int periodSize() const { return m_periodSize; }
+    void setPeriodSize(int frames);
+    [[nodiscard]] int bufferPeriods() const { return m_bufferPeriods; }
+    void setBufferPeriods(int periods);
+    [[nodiscard]] LatencyPreset latencyPreset() const { return m_latencyPreset; }
+    void setLatencyPreset(LatencyPreset preset);
+    // how much audio the ring buffer holds, in ms
+    [[nodiscard]] float bufferLatency() const;
+
+    [[nodiscard]] QVariantMap stats() const { return m_statsMap; }
+
+    [[nodiscard]] StretchQuality stretchQuality() const { return m_stretchQuality; }
+    void setStretchQuality(StretchQuality quality);
+    [[nodiscard]] bool adaptiveQuality() const { return m_adaptiveQuality; }
+    void setAdaptiveQuality(bool adaptive);
+    [[nodiscard]] StretchQuality activeQuality() const { return m_activeQuality; }
+
+    [[nodiscard]] float loopStart() const { return m_loopStart; }
+    void setLoopStart(float seconds);
+    [[nodiscard]] float loopEnd() const { return m_loopEnd; }
+    void setLoopEnd(float seconds);
+    Q_INVOKABLE
+    void setLoop(float startSeconds, float endSeconds);
+    [[nodiscard]] bool looping() const { return m_looping; }
+    void setLooping(bool looping);
+    [[nodiscard]] bool loopReady() const { return m_loopReady; }
 
 signals:
     void filePathChanged();
@@ -95,45 +223,91 @@ signals:
     void positionChanged();
     void durationChanged();
 
-    void signalStop();
-    void signalPositionUpdate();
-
     void speedChanged();
 
-    void displayBufferChanged();
+    // more peaks are available (or a different file was loaded)
+    void waveformChanged();
+
+    void loadingChanged();
+    void loadProgressChanged();
+    void sampleStorageChanged();
+
+    void outputDevicesChanged();
+    void outputDeviceChanged();
+    void deviceChanged();
+    void periodSizeChanged();
+    void bufferPeriodsChanged();
+    void latencyPresetChanged();
+    void statsChanged();
+    void stretchQualityChanged();
+    void adaptiveQualityChanged();
+    void activeQualityChanged();
+    void loopChanged();
+    void loopReadyChanged();
+
+    // emitted from the loop render thread
+    void signalLoopRendered();
+
+    // emitted from the decoder thread
+    void signalDecodeProgress();
 
 private slots:
-    void handleStop();
     void updatePosition();
+    void updateStats();
+    void handleLoopRendered();
+    void renderLoop();
+    void handleDecodeProgress();
 
 private:
     QString m_filePath;
 
+    QUrl m_loadedFile{};
+
+    ma_context m_context;
+    bool m_contextInit{false};
     ma_device m_device;
     bool m_deviceInit{false};
-
-    ma_data_converter m_converter;
-    bool m_converterInit{false};
-
-    // raw PCM data in RAM
-    std::vector<float> m_pcmBuffer{};
-    QList<float> m_displayBuffer{};
-    std::atomic<std::size_t> m_readIndex{0};
-
-    // defaults (44.1 kHz stereo)
-    int m_sampleRate{44100};
-    int m_channels{2};
-
-    // Miniaudio PCM data: [R L R L R L R L] (interleaved)
-    // Signalsmith stretch input: [R R R R], [L L L L] (split data)
-    std::array<std::vector<float>, 2> m_inputBuffer{}; // input from m_pcmBuffer
-    std::array<std::vector<float>, 2> m_outputBuffer{}; // output from stretcher.processs()
+    std::vector<ma_device_id> m_deviceIds{};
+    QStringList m_deviceNames{};
+    int m_outputDevice{-1};
+    int m_periodSize{DEFAULT_PERIOD_SIZE};
+    int m_bufferPeriods{DEFAULT_BUFFER_PERIODS};
+    LatencyPreset m_latencyPreset{Balanced};
+
+    // PCM data in RAM (source channel layout, device sample rate), filled progressively by the decoder thread
+    std::shared_ptr<SampleStore> m_sampleStore{};
+    // waveform of m_sampleStore, built alongside it
+    std::shared_ptr<PeakPyramid> m_peakPyramid{};
+    mutable std::mutex m_sampleStoreMutex;
+    SampleStorage m_sampleStorage{Int16};
+    std::atomic<std::size_t> m_readIndex{0}; // in frames, only moved by the worker
+
+    // device format, everything is decoded to this rate and downmixed to at most this many channels
+    int m_sampleRate{DEVICE_SAMPLERATE};
+    int m_channels{DEVICE_CHANNELS};
+
+    // Miniaudio PCM data: [L R C L R C L R C] (interleaved)
+    // Signalsmith stretch input: [L L L], [R R R], [C C C] (split data), only the first m_channels are used
+    using ChannelBuffers = std::array<std::vector<float>, MAX_DEVICE_CHANNELS>;
+    ChannelBuffers m_inputBuffer{}; // input from m_sampleStore
+    ChannelBuffers m_outputBuffer{}; // output from stretcher.processs()
+    // of the store's channels, the ones that get stretched: whole groups (see GroupStretcher), the rest is silent
+    [[nodiscard]] int stretchedChannels(const SampleStore& store) const;
 
     // ring buffer for audio playback
     ma_pcm_rb m_ringBuffer;
     bool m_rbInit{false};
 
-    signalsmith::stretch::SignalsmithStretch<float> m_stretcher;
+    // two, so a change of quality can crossfade from one configuration to the other
+    std::array<GroupStretcher, 2> m_stretchers{};
+    std::size_t m_activeStretcher{0}; // worker only
+    void configureStretcher(GroupStretcher& stretcher, StretchQuality quality) const;
+    // seeks stretcher to start, feeding it the pre-roll that comes before it
+    void primeStretcher(
+        GroupStretcher& stretcher,
+        const SampleStore& store,
+        std::size_t start,
+        float speed);
     std::atomic<float> m_speed{1.0f};
     static constexpr float m_minSpeed{MIN_SPEED};
     static constexpr float m_maxSpeed{MAX_SPEED};
@@ -141,19 +315,173 @@ private:
     std::atomic<bool> m_playing{false};
     float m_position{0.0f};
     float m_duration{0.0f};
-    std::atomic<std::size_t> m_frameCount{0};
+    float m_estimatedDuration{0.0f}; // from the container, until decoding finishes
+    bool m_decodeFinished{true};
+    bool m_loading{false};
+    float m_loadProgress{0.0f};
 
     // setup miniaudio backend
     friend void maDataCallback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount);
     // worker thread process (processes PCM data)
     std::thread m_processor;
     std::atomic<bool> m_processData{true};
+    // the worker blocks on this whenever there is nothing to do
+    WakeEvent m_workerWake{};
+
+    // requests from the GUI thread, applied by the worker between blocks
+    struct Command
+    {
+        enum class Type
+        {
+            Seek,
+            Speed,
+            Reset, // seek without pre-roll, for a new file
+            Quality,
+            Loop // frame to end, no loop if end is 0
+        };
+
+        Type type{Type::Seek};
+        std::size_t frame{0};
+        float speed{1.0f};
+        std::uint32_t serial{0}; // of a seek, see PlaybackSnapshot
+        StretchQuality quality{DefaultQuality};
+        std::size_t end{0};
+    };
+    SPSCQueue<Command, 64> m_commands{};
+    void pushCommand(const Command& command);
+    void applyCommands();
+    // how far the stretcher's output lags behind its input, in source frames
+    [[nodiscard]] double blockLatency(float speed) const;
+    [[nodiscard]] static double blockLatency(const GroupStretcher& stretcher, float speed);
+    float m_blockSpeed{1.0f}; // speed the worker stretches at
+    StretchQuality m_blockQuality{DefaultQuality}; // what the active stretcher is configured for
+    // the next block crossfades from the active stretcher to the other one, reading from m_fadeReadIndex
+    bool m_fading{false};
+    std::size_t m_fadeReadIndex{0};
+    ChannelBuffers m_fadeBuffer{};
+    void crossfadeStretchers(const SampleStore& store, std::size_t inputFrames, std::size_t blockFrames);
+
+    // the loop the worker plays, in source frames (end is 0 if there is none)
+    std::size_t m_blockLoopStart{0};
+    std::size_t m_blockLoopEnd{0};
+    // set while replaying a rendered loop instead of stretching, m_loopOffset is the next frame of it
+    std::shared_ptr<const LoopCache::Loop> m_loop{};
+    std::size_t m_loopOffset{0};
+    // back to the loop's start: straight into the rendered loop if there is one, otherwise by seeking the stretcher
+    void wrapLoop(const SampleStore& store);
+    // stretches live again from where m_loop has got to
+    void leaveLoop(const SampleStore& store);
+    // frames of loop from m_loopOffset on, wrapping around, recorded in the timeline if ringFrame is set
+    void readLoop(
+        const LoopCache::Loop& loop,
+        float* const* out,
+        std::size_t frames,
+        std::optional<std::uint64_t> ringFrame);
+    // records a block about to be written to the ring buffer in m_timeline, counting it if it didn't fit
+    void pushTimeline(const Timeline::Block& block);
+
+    // frames written to the ring buffer by the worker and read by the device,
+    // the device skips everything up to m_ringDiscardUntil (queued before a seek)
+    std::uint64_t m_ringWritten{0};
+    std::atomic<std::uint64_t> m_ringRead{0};
+    std::atomic<std::uint64_t> m_ringDiscardUntil{0};
+
+    // published by maDataCallback every period, polled by the GUI
+    struct PlaybackSnapshot
+    {
+        std::uint64_t frame{0};
+        std::uint32_t seek{0}; // serial of the last seek the worker applied
+        bool playing{false};   // false while the device is starved
+    };
+    SeqLock<PlaybackSnapshot> m_snapshot{};
+    std::uint32_t m_seekSerial{0}; // last one handed out, GUI thread only
+    std::uint32_t m_blockSeek{0};  // the one the worker is processing for
+
+    // source frame of each frame the device plays
+    Timeline m_timeline{};
+    QTimer m_positionTimer{};
+
+    // Everything maDataCallback reads apart from the atomics, the ring buffer and the queues. The GUI thread sets it up
+    // while no device is running (initDevice(), initHeadless()), after that it's the callback's alone until the device
+    // is stopped again, so the callback never has to wait for or allocate anything.
+    struct CallbackState
+    {
+        std::uint64_t deviceLatency{0}; // frames the device buffers after each callback
+        std::uint32_t refillFrames{0};  // free ring buffer space that's worth waking the worker for, a period
+        bool primed{false};             // had a full period since starting or seeking
+    };
+    CallbackState m_callback{};
+
+    // kept by maDataCallback and the worker
+    PlaybackStats m_stats{};
+    // what the GUI sees, refreshed every STATS_INTERVAL while playing
+    QTimer m_statsTimer{};
+    PlaybackStats::Totals m_lastTotals{};
+    QVariantMap m_statsMap{};
+    // one JSON object per refresh, if SPEEDSHIFTER_STATS_LOG names a file
+    QFile m_statsLog{};
+
+    StretchQuality m_stretchQuality{DefaultQuality};
+    bool m_adaptiveQuality{false};
+    StretchQuality m_activeQuality{DefaultQuality};
+    int m_calmIntervals{0};    // in a row, for stepping back up
+    int m_governorCooldown{0}; // intervals left to ignore after a switch, which costs a block or two
+    void setActiveQuality(StretchQuality quality);
+    // picks activeQuality from the last interval's stats
+    void governQuality(float peakLoad, std::uint32_t minFill, bool underrun);
+
+    float m_loopStart{0.0f};
+    float m_loopEnd{0.0f};
+    bool m_looping{false};
+    bool m_loopReady{false};
+    LoopCache m_loopCache{};
+    std::thread m_loopRenderer;
+    std::atomic<bool> m_loopRendering{false};
+    QTimer m_loopRenderTimer{};
+    // in source frames, {0, 0} unless looping over a long enough range
+    [[nodiscard]] std::pair<std::size_t, std::size_t> loopFrames() const;
+    // tells the worker, and renders the loop once things have settled
+    void updateLoop();
+    void setLoopReady(bool ready);
+    void stopLoopRender();
     friend void processPCM(void* data);
     void initWorkerThread();
+    void stopWorkerThread();
+
+    // (re)opens the device and sizes the ring buffer with the current settings
+    bool initDevice();
+    // no device, maDataCallback is pumped by the caller instead (see playbackharness.cpp)
+    bool initHeadless(int sampleRate, int channels = DEVICE_CHANNELS);
+    bool initRingBuffer();
+    // applies changed device settings, reloading the file if the sample rate changed
+    void restartDevice();
+    // switches to Custom if period size and buffer depth don't match a preset anymore
+    void updateLatencyPreset();
+
+    // decoder thread (opens the file and streams decoded + resampled PCM into m_sampleStore)
+    std::thread m_decoder;
+    std::atomic<bool> m_decodeData{false};
+    void decodePCM(QString filePath, SampleStore::Format format, int deviceRate, int deviceChannels);
+    // Streamed: opens the file from its header, then decodes it once only for the waveform (decodePCM() if the
+    // container doesn't know its length)
+    void streamPCM(QString filePath, int deviceRate, int deviceChannels);
+    void setSampleStore(std::shared_ptr<SampleStore> store, std::shared_ptr<PeakPyramid> peaks);
+    void stopDecoder();
+
+    // reported by the decoder thread, picked up by handleDecodeProgress()
+    struct DecodeProgress
+    {
+        float estimatedDuration{0.0f};
+        float progress{0.0f};
+        bool waveform{false}; // still being built after the store has finished, which keeps the load going
+    };
+    std::mutex m_progressMutex;
+    DecodeProgress m_pendingProgress{};
 
-    [[nodiscard]] int convertPCM(int sampleRate, int channels);
     void initBuffers();
-    void desamplePCM();
+
+    // drives maDataCallback from a simulated clock
+    friend class PlaybackHarness;
 };
 
 #endif // SPEEDSHIFTER_PLAYER_H
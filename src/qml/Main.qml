@@ -42,6 +42,12 @@ ApplicationWindow {
         return str.slice(str.lastIndexOf("/") + 1);
     }
 
+    function formatTime(seconds) {
+        let minutes = Math.floor(seconds / 60);
+        let rest = (seconds - minutes * 60).toFixed(1);
+        return minutes + ":" + (rest < 10 ? "0" : "") + rest;
+    }
+
     FileDialog {
         id: musicSelect
         nameFilters: ["Audio file (*.mp3 *.wma *.wav *.ogg *.flac)"]
@@ -61,6 +67,12 @@ ApplicationWindow {
                 shortcut: "Ctrl+O"
                 onTriggered: musicSelect.open()
             }
+            Action {
+                text: qsTr("&Cancel loading")
+                shortcut: "Escape"
+                enabled: player.loading
+                onTriggered: player.cancelLoad()
+            }
             MenuSeparator {}
             Action {
                 text: qsTr("&Quit")
@@ -68,6 +80,174 @@ ApplicationWindow {
                 onTriggered: Qt.quit()
             }
         }
+        Menu {
+            title: qsTr("&Audio")
+
+            Menu {
+                id: deviceMenu
+                title: qsTr("Output &device")
+                onAboutToShow: player.refreshDevices()
+
+                ActionGroup {
+                    id: deviceGroup
+                }
+
+                Action {
+                    text: qsTr("System default")
+                    checkable: true
+                    checked: player.outputDevice < 0
+                    ActionGroup.group: deviceGroup
+                    onTriggered: player.outputDevice = -1
+                }
+
+                MenuSeparator {}
+
+                Instantiator {
+                    model: player.outputDevices
+                    delegate: Action {
+                        required property int index
+                        required property string modelData
+
+                        text: modelData
+                        checkable: true
+                        checked: player.outputDevice === index
+                        ActionGroup.group: deviceGroup
+                        onTriggered: player.outputDevice = index
+                    }
+                    // after "System default" and the separator
+                    onObjectAdded: (index, object) => deviceMenu.insertAction(index + 2, object)
+                    onObjectRemoved: (index, object) => deviceMenu.removeAction(object)
+                }
+            }
+
+            Menu {
+                title: qsTr("&Latency (%1 ms)").arg(Math.round(player.bufferLatency))
+
+                ActionGroup {
+                    id: latencyGroup
+                }
+
+                Action {
+                    text: qsTr("&Low latency")
+                    checkable: true
+                    checked: player.latencyPreset === Player.LowLatency
+                    ActionGroup.group: latencyGroup
+                    onTriggered: player.latencyPreset = Player.LowLatency
+                }
+                Action {
+                    text: qsTr("&Balanced")
+                    checkable: true
+                    checked: player.latencyPreset === Player.Balanced
+                    ActionGroup.group: latencyGroup
+                    onTriggered: player.latencyPreset = Player.Balanced
+                }
+                Action {
+                    text: qsTr("&Power saving")
+                    checkable: true
+                    checked: player.latencyPreset === Player.PowerSaving
+                    ActionGroup.group: latencyGroup
+                    onTriggered: player.latencyPreset = Player.PowerSaving
+                }
+            }
+
+            Menu {
+                title: qsTr("Stretch &quality")
+
+                ActionGroup {
+                    id: qualityGroup
+                }
+
+                Action {
+                    text: qsTr("&Cheaper")
+                    checkable: true
+                    checked: player.stretchQuality === Player.CheaperQuality
+                    ActionGroup.group: qualityGroup
+                    onTriggered: player.stretchQuality = Player.CheaperQuality
+                }
+                Action {
+                    text: qsTr("&Default")
+                    checkable: true
+                    checked: player.stretchQuality === Player.DefaultQuality
+                    ActionGroup.group: qualityGroup
+                    onTriggered: player.stretchQuality = Player.DefaultQuality
+                }
+                Action {
+                    text: qsTr("&High quality")
+                    checkable: true
+                    checked: player.stretchQuality === Player.HighQuality
+                    ActionGroup.group: qualityGroup
+                    onTriggered: player.stretchQuality = Player.HighQuality
+                }
+
+                MenuSeparator {}
+
+                // steps down while the CPU can't keep up, never above the choice above
+                Action {
+                    text: qsTr("&Adapt to CPU load")
+                    checkable: true
+                    checked: player.adaptiveQuality
+                    onTriggered: player.adaptiveQuality = checked
+                }
+            }
+
+            MenuSeparator {}
+
+            // for recordings too long to decode up front, applies to the next file opened
+            Action {
+                text: qsTr("Decode on &demand")
+                checkable: true
+                checked: player.sampleStorage === Player.Streamed
+                onTriggered: player.sampleStorage = checked ? Player.Streamed : Player.Int16
+            }
+
+            Action {
+                id: statsAction
+                text: qsTr("Performance &stats")
+                shortcut: "Ctrl+I"
+                checkable: true
+            }
+        }
+        Menu {
+            title: qsTr("&Loop")
+
+            Action {
+                text: qsTr("Set &A (%1)").arg(formatTime(player.loopStart))
+                shortcut: "["
+                enabled: musicPath.text ? true : false
+                onTriggered: player.setLoop(player.position, Math.max(player.loopEnd, player.position))
+            }
+            Action {
+                text: qsTr("Set &B (%1)").arg(formatTime(player.loopEnd))
+                shortcut: "]"
+                enabled: musicPath.text ? true : false
+                onTriggered: player.setLoop(Math.min(player.loopStart, player.position), player.position)
+            }
+            Action {
+                text: qsTr("&Clear")
+                enabled: player.loopEnd > 0
+                onTriggered: {
+                    player.looping = false;
+                    player.setLoop(0, 0);
+                }
+            }
+
+            MenuSeparator {}
+
+            // plays the stretched live audio until the pre-rendered loop is ready
+            Action {
+                text: player.looping && !player.loopReady ? qsTr("&Loop A-B (rendering...)") : qsTr("&Loop A-B")
+                shortcut: "L"
+                checkable: true
+                checked: player.looping
+                enabled: player.loopEnd > player.loopStart
+                onTriggered: {
+                    player.looping = checked;
+                    if (checked && (player.position < player.loopStart || player.position >= player.loopEnd)) {
+                        player.position = player.loopStart;
+                    }
+                }
+            }
+        }
     }
 
     ColumnLayout {
@@ -83,47 +263,90 @@ ApplicationWindow {
             Layout.fillWidth: true
             Layout.fillHeight: true
 
-            ListView {
-                id: waveListView
+            Waveform {
+                id: waveform
                 anchors.fill: parent
-                orientation: ListView.Horizontal
-                interactive: false
-
-                model: player.displayBuffer
 
-                readonly property real itemWidth: 4
-                property real posX: player.duration > 0 ? (player.position / player.duration) * count * itemWidth - (width / 2) : 0
-                contentX: posX
+                player: player
+                position: player.position
+                // one 4 px bar per 1/sampleDensity seconds
+                barWidth: 4
+                pixelsPerSecond: barWidth * player.sampleDensity
+                color: root.palette.placeholderText
+                playedColor: root.palette.highlight
+            }
 
-                Behavior on contentX {
-                    NumberAnimation {
-                        duration: 200 / player.speed
-                        easing.type: Easing.OutCubic
-                    }
+            // how close the worker is to missing its deadlines, refreshed while playing
+            Rectangle {
+                id: statsOverlay
+                visible: statsAction.checked
+                anchors.top: parent.top
+                anchors.right: parent.right
+                anchors.margins: 10
+                width: statsColumn.implicitWidth + 20
+                height: statsColumn.implicitHeight + 20
+                radius: 4
+                color: root.palette.window
+                opacity: 0.9
+                border.color: root.palette.mid
+
+                function percent(value) {
+                    return Math.round((value || 0) * 100) + "%";
                 }
 
-                // currentIndex: player.duration > 0 ? Math.floor((player.position / player.duration) * waveListView.count) : 0
-
-                delegate: Item {
-                    width: waveListView.itemWidth - waveListView.spacing
-                    height: waveListView.height
+                ColumnLayout {
+                    id: statsColumn
+                    anchors.centerIn: parent
+                    spacing: 2
 
-                    Rectangle {
-                        anchors.centerIn: parent
-                        width: parent.width
-                        height: Math.max(4, modelData * parent.height * 0.8 * Math.min(1.0, Math.max(0.0, 1.0 - Math.pow((index * waveListView.itemWidth - (waveListView.posX + waveListView.width / 2)) / (waveListView.width / 2), 49.0))))
-                        Behavior on height {
-                            NumberAnimation {
-                                duration: 50
-                                easing.type: Easing.InOutQuad
-                            }
-                        }
-                        color: (index * waveListView.itemWidth) <= (waveListView.posX + waveListView.width / 2) ? root.palette.highlight : root.palette.placeholderText
+                    Label {
+                        text: qsTr("Load %1 (peak %2), headroom %3")
+                            .arg(statsOverlay.percent(player.stats.load))
+                            .arg(statsOverlay.percent(player.stats.peakLoad))
+                            .arg(statsOverlay.percent(player.stats.headroom))
+                    }
+                    Label {
+                        text: qsTr("Quality: %1").arg([qsTr("cheaper"), qsTr("default"), qsTr("high")][player.activeQuality])
+                    }
+                    Label {
+                        text: qsTr("Buffer %1 full (lowest %2)")
+                            .arg(statsOverlay.percent(player.stats.fill))
+                            .arg(statsOverlay.percent(player.stats.minFill))
+                    }
+                    Label {
+                        text: qsTr("%1 underruns (%2 frames of silence)")
+                            .arg(player.stats.underruns || 0)
+                            .arg(player.stats.silentFrames || 0)
+                    }
+                    Label {
+                        text: qsTr("%1 short writes (%2 frames dropped)")
+                            .arg(player.stats.shortWrites || 0)
+                            .arg(player.stats.droppedFrames || 0)
+                    }
+                    Label {
+                        text: qsTr("%1 blocks missing from the position timeline")
+                            .arg(player.stats.timelineDrops || 0)
+                    }
 
-                        Behavior on color {
-                            ColorAnimation {
-                                duration: 130
-                                easing.type: Easing.Linear
+                    // blocks by how much of their deadline they took, 0 .. 2x, the red ones were late
+                    Row {
+                        id: histogramRow
+                        property var counts: player.stats.loadHistogram || []
+                        property real most: Math.max(1, ...counts)
+                        Layout.topMargin: 4
+                        height: 30
+                        spacing: 1
+
+                        Repeater {
+                            model: histogramRow.counts
+                            delegate: Rectangle {
+                                required property int index
+                                required property var modelData
+
+                                anchors.bottom: parent.bottom
+                                width: 8
+                                height: Math.max(1, histogramRow.height * modelData / histogramRow.most)
+                                color: index * (player.stats.loadBucketWidth || 0) >= 1 ? "red" : root.palette.highlight
                             }
                         }
                     }
@@ -131,6 +354,18 @@ ApplicationWindow {
             }
         }
 
+        ProgressBar {
+            id: loadProgressBar
+            visible: player.loading
+            from: 0
+            to: 1
+            value: player.loadProgress
+
+            Layout.leftMargin: 20
+            Layout.rightMargin: 20
+            Layout.fillWidth: true
+        }
+
         Rectangle {
             id: divider
             Layout.fillWidth: true
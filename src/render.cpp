@@ -0,0 +1,204 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#include "render.h"
+#include "kernels.h"
+
+#include <signalsmith-stretch.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // output frames per process() call
+    constexpr std::size_t s_blockFrames{4096};
+
+    using Planar = std::array<std::vector<float>, SampleStore::s_maxChannels>;
+
+    // count frames from frame on into out, zeros outside the store
+    void readPadded(const SampleStore& store, const std::int64_t frame, const std::size_t count, Planar& out)
+    {
+        const int channels{store.channels()};
+        std::array<float*, SampleStore::s_maxChannels> pointers{};
+        for (int c{0}; c < channels; ++c)
+        {
+            out[c].resize(std::max(out[c].size(), count));
+            pointers[c] = out[c].data();
+        }
+
+        // leading silence before the first frame
+        const std::size_t before{frame < 0 ? std::min(static_cast<std::size_t>(-frame), count) : 0};
+        for (int c{0}; c < channels; ++c)
+        {
+            Kernels::zero(pointers[c], before);
+            pointers[c] += before;
+        }
+
+        const std::size_t start{static_cast<std::size_t>(std::max<std::int64_t>(frame, 0))};
+        const std::size_t read{before < count ? store.read(start, count - before, pointers.data(), channels) : 0};
+        for (int c{0}; c < channels; ++c)
+        {
+            Kernels::zero(pointers[c] + read, count - before - read);
+        }
+    }
+
+    // output frames [start, end) as interleaved float
+    std::vector<float> renderSegment(
+        const SampleStore& store,
+        const int sampleRate,
+        const float speed,
+        const std::size_t start,
+        const std::size_t end,
+        const std::atomic<bool>& running)
+    {
+        const int channels{store.channels()};
+        signalsmith::stretch::SignalsmithStretch<float> stretcher{};
+        stretcher.presetDefault(channels, static_cast<float>(sampleRate));
+
+        // the first output frame comes from a latency ahead of where the input starts (see Player::blockLatency())
+        const double latency{static_cast<double>(stretcher.inputLatency()) +
+                             static_cast<double>(stretcher.outputLatency()) * speed};
+        const double sourceStart{static_cast<double>(start) * speed + latency};
+
+        Planar input{};
+        Planar output{};
+
+        // prime the stretcher on what comes before, so the segment starts without a fade in
+        const std::int64_t first{std::llround(sourceStart)};
+        const std::size_t preRoll{static_cast<std::size_t>(stretcher.blockSamples() + stretcher.intervalSamples())};
+        readPadded(store, first - static_cast<std::int64_t>(preRoll), preRoll, input);
+        std::array<float*, SampleStore::s_maxChannels> inputs{};
+        std::array<float*, SampleStore::s_maxChannels> outputs{};
+        for (int c{0}; c < channels; ++c)
+        {
+            inputs[c] = input[c].data();
+        }
+        stretcher.seek(inputs.data(), static_cast<int>(preRoll), speed);
+
+        std::vector<float> result((end - start) * channels);
+        std::int64_t consumed{first};
+        for (std::size_t done{0}; done < end - start && running.load();)
+        {
+            const std::size_t outN{std::min(s_blockFrames, end - start - done)};
+            // rounded from the segment's start so blocks never drift apart
+            const std::int64_t next{std::llround(sourceStart + static_cast<double>(done + outN) * speed)};
+            const std::size_t inN{static_cast<std::size_t>(std::max<std::int64_t>(next - consumed, 0))};
+
+            readPadded(store, consumed, inN, input);
+            for (int c{0}; c < channels; ++c)
+            {
+                output[c].resize(std::max(output[c].size(), outN));
+                inputs[c] = input[c].data();
+                outputs[c] = output[c].data();
+            }
+
+            stretcher.process(inputs.data(), static_cast<int>(inN), outputs.data(), static_cast<int>(outN));
+            Kernels::interleave(outputs.data(), result.data() + done * channels, channels, outN);
+
+            consumed = next;
+            done += outN;
+        }
+        return result;
+    }
+} // namespace
+
+std::size_t Render::outputFrames(const std::size_t frames, const float speed)
+{
+    return static_cast<std::size_t>(std::ceil(static_cast<double>(frames) / speed));
+}
+
+bool Render::stretch(
+    const SampleStore& store,
+    const int sampleRate,
+    const Settings& settings,
+    const Sink& sink,
+    const std::atomic<bool>& running)
+{
+    const int channels{store.channels()};
+    const std::size_t total{outputFrames(store.frames(), settings.speed)};
+
+    // segments have to be at least two crossfades long
+    const std::size_t crossfade{static_cast<std::size_t>(settings.crossfadeSeconds * sampleRate)};
+    const std::size_t segment{std::max(
+        static_cast<std::size_t>(settings.segmentSeconds * sampleRate), std::max<std::size_t>(crossfade * 2, 1))};
+    const std::size_t segments{(total + segment - 1) / segment};
+
+    const int threads{
+        settings.threads > 0 ? settings.threads : std::max(static_cast<int>(std::thread::hardware_concurrency()), 1)};
+
+    // the end of the previous segment, faded out against the start of the next one
+    std::vector<float> tail{};
+
+    // one segment per thread at a time, which also bounds the memory to a few segments
+    for (std::size_t wave{0}; wave < segments; wave += threads)
+    {
+        const std::size_t count{std::min(static_cast<std::size_t>(threads), segments - wave)};
+        std::vector<std::vector<float>> rendered(count);
+        const auto render{[&](const std::size_t i)
+        {
+            const std::size_t index{wave + i};
+            // everything but the first segment starts a crossfade early
+            const std::size_t start{index == 0 ? 0 : index * segment - crossfade};
+            const std::size_t end{std::min((index + 1) * segment, total)};
+            rendered[i] = renderSegment(store, sampleRate, settings.speed, start, end, running);
+        }};
+
+        if (count == 1)
+        {
+            render(0);
+        }
+        else
+        {
+            std::vector<std::thread> workers{};
+            for (std::size_t i{0}; i < count; ++i)
+            {
+                workers.emplace_back(render, i);
+            }
+            for (std::thread& worker : workers)
+            {
+                worker.join();
+            }
+        }
+
+        if (!running.load())
+        {
+            return false;
+        }
+
+        for (std::size_t i{0}; i < count; ++i)
+        {
+            std::vector<float>& audio{rendered[i]};
+            const std::size_t frames{audio.size() / channels};
+
+            if (!tail.empty())
+            {
+                for (std::size_t f{0}; f < crossfade; ++f)
+                {
+                    // both sides stretch the same audio in step, so the gains add up to one rather than the power
+                    const float angle{(static_cast<float>(f) + 0.5f) / static_cast<float>(crossfade) * 1.5707964f};
+                    const float fadeIn{std::sin(angle) * std::sin(angle)};
+                    const float fadeOut{1.0f - fadeIn};
+                    for (int c{0}; c < channels; ++c)
+                    {
+                        const std::size_t sample{f * channels + c};
+                        audio[sample] = tail[sample] * fadeOut + audio[sample] * fadeIn;
+                    }
+                }
+            }
+
+            // the last crossfade's worth is held back for the next segment
+            const bool last{wave + i + 1 == segments};
+            const std::size_t keep{last ? 0 : crossfade};
+            if (!sink(audio.data(), frames - keep))
+            {
+                return false;
+            }
+            tail.assign(audio.end() - static_cast<std::ptrdiff_t>(keep * channels), audio.end());
+        }
+    }
+
+    return true;
+}
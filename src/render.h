@@ -0,0 +1,40 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_RENDER_H
+#define SPEEDSHIFTER_RENDER_H
+
+#include "samplestore.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+// Offline time stretching, as fast as the CPU allows.
+// The output is cut into segments that are stretched in parallel, each by its own stretcher primed on the
+// audio right before it, and joined again with a short crossfade.
+namespace Render
+{
+    struct Settings
+    {
+        float speed{1.0f};
+        double segmentSeconds{20.0};
+        double crossfadeSeconds{0.05};
+        int threads{0}; // 0 uses every core
+    };
+
+    // gets the stretched audio in order, interleaved, returns false to stop
+    using Sink = std::function<bool(const float* interleaved, std::size_t frames)>;
+
+    // frames of output for frames of input at speed
+    [[nodiscard]] std::size_t outputFrames(std::size_t frames, float speed);
+
+    // stretches a finished store, returns false if the sink or running stopped it early
+    bool stretch(
+        const SampleStore& store,
+        int sampleRate,
+        const Settings& settings,
+        const Sink& sink,
+        const std::atomic<bool>& running);
+} // namespace Render
+
+#endif // SPEEDSHIFTER_RENDER_H
@@ -0,0 +1,200 @@
+// Created by Jens Kromdijk 17/10/2026
+
+// Headless offline rendering: decodes a file, stretches it to another speed on every core and writes it
+// as WAV or FLAC, without opening an audio device or a QML engine.
+// usage: speedshifter-render [--speed 0.75] [--threads N] [--segment seconds] <input> <output.wav|.flac>
+//        speedshifter-render --speeds 0.75,0.9,1.25 --output-dir <dir> [--format flac] [--memory MB] <inputs...>
+
+#include "batch.h"
+#include "decoder.h"
+#include "encoder.h"
+#include "render.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+    double secondsSince(const std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    int runBatch(
+        const QCommandLineParser& parser,
+        const QCommandLineOption& speedsOption,
+        const QCommandLineOption& outputDirOption,
+        const QCommandLineOption& formatOption,
+        const QCommandLineOption& memoryOption,
+        const QCommandLineOption& threadsOption)
+    {
+        Batch::Settings settings{};
+        for (const QString& value : parser.value(speedsOption).split(','))
+        {
+            bool ok;
+            const float speed{value.toFloat(&ok)};
+            if (!ok || speed <= 0.0f)
+            {
+                std::fprintf(stderr, "invalid speed: %s\n", qPrintable(value));
+                return 1;
+            }
+            settings.speeds.push_back(speed);
+        }
+
+        settings.outputDir = parser.value(outputDirOption);
+        settings.extension = parser.value(formatOption).toLower();
+        bool memoryOk;
+        bool threadsOk;
+        settings.memoryCap = static_cast<std::size_t>(parser.value(memoryOption).toULongLong(&memoryOk)) * 1024 * 1024;
+        settings.threads = parser.value(threadsOption).toInt(&threadsOk);
+        if (settings.outputDir.isEmpty() || (settings.extension != "wav" && settings.extension != "flac") ||
+            !memoryOk || settings.memoryCap == 0 || !threadsOk || settings.threads < 0)
+        {
+            std::fprintf(stderr, "batch mode needs --output-dir, --format wav/flac, a valid --memory and --threads\n");
+            return 1;
+        }
+        if (!QDir{}.mkpath(settings.outputDir))
+        {
+            std::fprintf(stderr, "can't create %s\n", qPrintable(settings.outputDir));
+            return 1;
+        }
+
+        settings.files = Batch::expand(parser.positionalArguments());
+        if (settings.files.isEmpty())
+        {
+            std::fprintf(stderr, "nothing to render\n");
+            return 1;
+        }
+
+        const Batch::Result result{Batch::run(settings)};
+        const double wall{std::max(result.wallSeconds, 1e-9)};
+        std::printf(
+            "%d files -> %d outputs (%d failed) in %.2f s: %.2f files/s, %.1f s of audio written, %.1fx realtime\n",
+            result.sources,
+            result.outputs,
+            result.failed,
+            result.wallSeconds,
+            static_cast<double>(result.outputs) / wall,
+            result.outputSeconds,
+            result.outputSeconds / wall);
+        return result.failed == 0 ? 0 : 1;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app{argc, argv};
+    QCoreApplication::setApplicationName("speedshifter-render");
+
+    QCommandLineParser parser{};
+    parser.setApplicationDescription("Renders an audio file at a different speed without changing its pitch.");
+    parser.addHelpOption();
+    const QCommandLineOption speedOption{{"s", "speed"}, "Playback speed (default 1).", "speed", "1"};
+    const QCommandLineOption threadsOption{{"j", "threads"}, "Worker threads (default: every core).", "count", "0"};
+    const QCommandLineOption segmentOption{
+        "segment", "Seconds of output stretched per thread at a time (default 20).", "seconds", "20"};
+    const QCommandLineOption speedsOption{
+        "speeds", "Batch mode: render every input at each of these comma separated speeds.", "speeds"};
+    const QCommandLineOption outputDirOption{{"o", "output-dir"}, "Batch mode: directory to write to.", "dir"};
+    const QCommandLineOption formatOption{"format", "Batch mode: wav or flac (default flac).", "format", "flac"};
+    const QCommandLineOption memoryOption{
+        "memory", "Batch mode: MB of decoded audio held at once (default 2048).", "MB", "2048"};
+    parser.addOption(speedOption);
+    parser.addOption(threadsOption);
+    parser.addOption(segmentOption);
+    parser.addOption(speedsOption);
+    parser.addOption(outputDirOption);
+    parser.addOption(formatOption);
+    parser.addOption(memoryOption);
+    parser.addPositionalArgument("input", "Audio file to render (batch mode: files, directories or patterns).");
+    parser.addPositionalArgument("output", "File to write, .wav or .flac (not in batch mode).");
+    parser.process(app);
+
+    if (parser.isSet(speedsOption))
+    {
+        return runBatch(parser, speedsOption, outputDirOption, formatOption, memoryOption, threadsOption);
+    }
+
+    const QStringList arguments{parser.positionalArguments()};
+    if (arguments.size() != 2)
+    {
+        parser.showHelp(1);
+    }
+
+    Render::Settings settings{};
+    bool speedOk;
+    bool threadsOk;
+    bool segmentOk;
+    settings.speed = parser.value(speedOption).toFloat(&speedOk);
+    settings.threads = parser.value(threadsOption).toInt(&threadsOk);
+    settings.segmentSeconds = parser.value(segmentOption).toDouble(&segmentOk);
+    if (!speedOk || settings.speed <= 0.0f || !threadsOk || settings.threads < 0 || !segmentOk ||
+        settings.segmentSeconds <= 0.0)
+    {
+        std::fprintf(stderr, "invalid --speed, --threads or --segment\n");
+        return 1;
+    }
+
+    const QString& input{arguments[0]};
+    const QString& output{arguments[1]};
+    std::atomic<bool> running{true};
+
+    // the file's own rate and channels, nothing to match a device to
+    const auto start{std::chrono::steady_clock::now()};
+    int sampleRate{0};
+    bool complete{false};
+    const std::shared_ptr<SampleStore> store{Decoder::decodeParallel(
+        input,
+        SampleStore::Format::Float,
+        0,
+        SampleStore::s_maxChannels,
+        running,
+        [&](const std::shared_ptr<SampleStore>&, const Decoder::Stream& stream) { sampleRate = stream.sampleRate; },
+        nullptr,
+        &complete,
+        settings.threads)};
+    if (!store || !complete)
+    {
+        std::fprintf(stderr, "failed to decode %s\n", qPrintable(input));
+        return 1;
+    }
+    store->finish();
+    const double decodeSeconds{secondsSince(start)};
+
+    const auto renderStart{std::chrono::steady_clock::now()};
+    AudioEncoder encoder{};
+    if (!encoder.open(output, sampleRate, store->channels()))
+    {
+        return 1;
+    }
+
+    const bool rendered{Render::stretch(
+        *store,
+        sampleRate,
+        settings,
+        [&](const float* audio, const std::size_t frames) { return encoder.write(audio, frames); },
+        running)};
+    if (!encoder.close() || !rendered)
+    {
+        std::fprintf(stderr, "failed to write %s\n", qPrintable(output));
+        return 1;
+    }
+    const double renderSeconds{secondsSince(renderStart)};
+
+    const double outputSeconds{static_cast<double>(Render::outputFrames(store->frames(), settings.speed)) / sampleRate};
+    std::printf(
+        "decoded %.1f s of audio in %.2f s, rendered %.1f s at %.2fx in %.2f s (%.1fx realtime)\n",
+        static_cast<double>(store->frames()) / sampleRate,
+        decodeSeconds,
+        outputSeconds,
+        settings.speed,
+        renderSeconds,
+        outputSeconds / std::max(renderSeconds + decodeSeconds, 1e-9));
+    return 0;
+}
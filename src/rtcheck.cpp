@@ -0,0 +1,136 @@
+// Created by Jens Kromdijk 17/10/2026
+
+// Only compiled with SPEEDSHIFTER_RT_CHECKS. Defining malloc and friends in the executable takes precedence over
+// glibc's for every library in the process, the originals are still there under their __libc_ names.
+
+#include "rtcheck.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <unistd.h>
+
+extern "C" {
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* pointer, std::size_t size);
+void* __libc_memalign(std::size_t alignment, std::size_t size);
+void __libc_free(void* pointer);
+}
+
+namespace
+{
+    // initial-exec TLS in the executable, reading it never allocates
+    thread_local bool t_realtime{false};
+
+    using MutexLock = int (*)(pthread_mutex_t*);
+    std::atomic<MutexLock> s_mutexLock{nullptr};
+
+    // looked up on first use, libraries lock mutexes before static initialisers have run
+    [[nodiscard]] MutexLock mutexLock()
+    {
+        MutexLock lock{s_mutexLock.load(std::memory_order_relaxed)};
+        if (!lock)
+        {
+            lock = reinterpret_cast<MutexLock>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+            s_mutexLock.store(lock, std::memory_order_relaxed);
+        }
+        return lock;
+    }
+
+    [[noreturn]] void violation(const char* call)
+    {
+        // whatever happens from here on must not come back in
+        t_realtime = false;
+
+        // straight to the fd, stdio may allocate or lock
+        const char prefix[]{"real-time violation: "};
+        const char suffix[]{" called on the audio thread\n"};
+        [[maybe_unused]] ssize_t written{write(STDERR_FILENO, prefix, sizeof(prefix) - 1)};
+        written = write(STDERR_FILENO, call, std::strlen(call));
+        written = write(STDERR_FILENO, suffix, sizeof(suffix) - 1);
+        std::abort();
+    }
+} // namespace
+
+RealtimeScope::RealtimeScope()
+{
+    t_realtime = true;
+}
+
+RealtimeScope::~RealtimeScope()
+{
+    t_realtime = false;
+}
+
+extern "C" {
+void* malloc(const std::size_t size)
+{
+    if (t_realtime)
+    {
+        violation("malloc");
+    }
+    return __libc_malloc(size);
+}
+
+void* calloc(const std::size_t count, const std::size_t size)
+{
+    if (t_realtime)
+    {
+        violation("calloc");
+    }
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, const std::size_t size)
+{
+    if (t_realtime)
+    {
+        violation("realloc");
+    }
+    return __libc_realloc(pointer, size);
+}
+
+void* aligned_alloc(const std::size_t alignment, const std::size_t size)
+{
+    if (t_realtime)
+    {
+        violation("aligned_alloc");
+    }
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** pointer, const std::size_t alignment, const std::size_t size)
+{
+    if (t_realtime)
+    {
+        violation("posix_memalign");
+    }
+    *pointer = __libc_memalign(alignment, size);
+    return *pointer ? 0 : ENOMEM;
+}
+
+void free(void* pointer)
+{
+    if (t_realtime && pointer)
+    {
+        violation("free");
+    }
+    __libc_free(pointer);
+}
+
+// trylock is left alone, it never waits
+int pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+    if (t_realtime)
+    {
+        violation("pthread_mutex_lock");
+    }
+    return mutexLock()(mutex);
+}
+}
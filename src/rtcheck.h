@@ -0,0 +1,24 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_RTCHECK_H
+#define SPEEDSHIFTER_RTCHECK_H
+
+// Marks the calling thread as real-time for as long as it exists.
+// Built with SPEEDSHIFTER_RT_CHECKS (the CMake option, Linux only) malloc, free and pthread_mutex_lock are interposed
+// for the whole process, and calling any of them inside a scope prints what was called and aborts. Without it the
+// scope is empty and compiles away.
+class RealtimeScope
+{
+public:
+#ifdef SPEEDSHIFTER_RT_CHECKS
+    RealtimeScope();
+    ~RealtimeScope();
+#else
+    RealtimeScope() = default;
+#endif
+
+    RealtimeScope(const RealtimeScope&) = delete;
+    RealtimeScope& operator=(const RealtimeScope&) = delete;
+};
+
+#endif // SPEEDSHIFTER_RTCHECK_H
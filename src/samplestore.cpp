@@ -0,0 +1,504 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#include "samplestore.h"
+#include "kernels.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace
+{
+    [[nodiscard]] inline std::uint32_t zigzag(const std::int32_t value)
+    {
+        return (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+    }
+
+    [[nodiscard]] inline std::int32_t unzigzag(const std::uint32_t value)
+    {
+        return static_cast<std::int32_t>(value >> 1) ^ -static_cast<std::int32_t>(value & 1);
+    }
+
+    // per channel: int16 first sample, uint8 bit width, then (frames - 1) deltas
+    [[nodiscard]] constexpr std::size_t encodedChannelSize(const std::size_t frames, const unsigned bits)
+    {
+        return 3 + ((frames - 1) * bits + 7) / 8;
+    }
+} // namespace
+
+std::shared_ptr<SampleStore> SampleStore::create(const Format format, int channels)
+{
+    channels = std::clamp(channels, 1, s_maxChannels);
+    switch (format)
+    {
+        case Format::Int16:
+            return std::make_shared<InterleavedStore<std::int16_t>>(channels);
+        case Format::Packed:
+            return std::make_shared<PackedStore>(channels);
+        case Format::Float:
+        default:
+            return std::make_shared<InterleavedStore<float>>(channels);
+    }
+}
+
+void SampleStore::appendNative(const void* data, std::size_t frames)
+{
+    const std::size_t frameSize{m_channels * (floatSamples() ? sizeof(float) : sizeof(std::int16_t))};
+    const auto* source{static_cast<const std::uint8_t*>(data)};
+
+    while (frames > 0)
+    {
+        std::size_t space;
+        void* dest{beginWrite(space)};
+        if (!dest)
+        {
+            // store is full, drop the rest
+            break;
+        }
+
+        const std::size_t count{std::min(frames, space)};
+        std::memcpy(dest, source, count * frameSize);
+        endWrite(count);
+
+        source += count * frameSize;
+        frames -= count;
+    }
+}
+
+void SampleStore::append(const float* data, std::size_t frames)
+{
+    if (floatSamples())
+    {
+        appendNative(data, frames);
+        return;
+    }
+
+    while (frames > 0)
+    {
+        std::size_t space;
+        auto* dest{static_cast<std::int16_t*>(beginWrite(space))};
+        if (!dest)
+        {
+            break;
+        }
+
+        const std::size_t count{std::min(frames, space)};
+        for (std::size_t i{0}; i < count * m_channels; ++i)
+        {
+            dest[i] = Kernels::toInt16(data[i]);
+        }
+        endWrite(count);
+
+        data += count * m_channels;
+        frames -= count;
+    }
+}
+
+std::size_t SampleStore::read(
+    const std::size_t frame, const std::size_t count, float* const* out, const int outChannels) const
+{
+    const std::size_t frames{readPlanar(frame, count, out)};
+
+    // spread mono over every output channel, silence the ones the source doesn't have
+    for (int c{m_channels}; c < outChannels; ++c)
+    {
+        if (m_channels == 1)
+        {
+            std::memcpy(out[c], out[0], frames * sizeof(float));
+        }
+        else
+        {
+            std::fill_n(out[c], frames, 0.0f);
+        }
+    }
+
+    return frames;
+}
+
+std::size_t SampleStore::readNative(std::size_t frame, const std::size_t count, void* out) const
+{
+    if (floatSamples())
+    {
+        return readInterleaved(frame, count, static_cast<float*>(out));
+    }
+
+    // quantised the same way append() does, so 16-bit samples come back as they went in
+    std::array<float, 4096> scratch;
+    const std::size_t step{scratch.size() / m_channels};
+    auto* dest{static_cast<std::int16_t*>(out)};
+    std::size_t done{0};
+    while (done < count)
+    {
+        const std::size_t frames{readInterleaved(frame, std::min(step, count - done), scratch.data())};
+        if (frames == 0)
+        {
+            break;
+        }
+
+        for (std::size_t i{0}; i < frames * m_channels; ++i)
+        {
+            dest[done * m_channels + i] = Kernels::toInt16(scratch[i]);
+        }
+        done += frames;
+        frame += frames;
+    }
+
+    return done;
+}
+
+template <typename Sample>
+InterleavedStore<Sample>::InterleavedStore(const int channels) :
+    SampleStore{std::is_same_v<Sample, float> ? Format::Float : Format::Int16, channels}
+{
+}
+
+template <typename Sample>
+InterleavedStore<Sample>::InterleavedStore(
+    const int channels, const Sample* data, const std::size_t frames, std::shared_ptr<const void> owner) :
+    SampleStore{std::is_same_v<Sample, float> ? Format::Float : Format::Int16, channels}, m_owner{std::move(owner)}
+{
+    std::size_t index{0};
+    while (m_capacity < frames && m_chunks.set(index, data + m_capacity * m_channels))
+    {
+        m_capacity += s_chunkFrames;
+        ++index;
+    }
+
+    publish(std::min(frames, m_capacity));
+    finish();
+}
+
+template <typename Sample>
+void* InterleavedStore<Sample>::beginWrite(std::size_t& frames)
+{
+    const std::size_t writeIndex{this->frames()};
+    if (writeIndex == m_capacity)
+    {
+        std::unique_ptr<Sample[]> chunk{std::make_unique<Sample[]>(s_chunkFrames * m_channels)};
+        if (!m_chunks.set(m_capacity / s_chunkFrames, chunk.get()))
+        {
+            // out of chunk slots
+            frames = 0;
+            return nullptr;
+        }
+
+        m_storage.emplace_back(std::move(chunk));
+        m_capacity += s_chunkFrames;
+    }
+
+    const std::size_t offset{writeIndex % s_chunkFrames};
+    frames = s_chunkFrames - offset;
+    return m_storage[writeIndex / s_chunkFrames].get() + offset * m_channels;
+}
+
+template <typename Sample>
+void InterleavedStore<Sample>::endWrite(const std::size_t frames)
+{
+    // make the new frames visible to readers
+    publish(this->frames() + frames);
+}
+
+template <typename Sample>
+std::size_t InterleavedStore<Sample>::readPlanar(std::size_t frame, const std::size_t count, float* const* out) const
+{
+    const std::size_t available{frames()};
+    if (frame >= available)
+    {
+        return 0;
+    }
+
+    const std::size_t total{std::min(count, available - frame)};
+    std::size_t done{0};
+    while (done < total)
+    {
+        const std::size_t offset{frame % s_chunkFrames};
+        const std::size_t length{std::min(total - done, s_chunkFrames - offset)};
+        const Sample* source{m_chunks.at(frame / s_chunkFrames) + offset * m_channels};
+
+        std::array<float*, s_maxChannels> dest{};
+        for (int c{0}; c < m_channels; ++c)
+        {
+            dest[c] = out[c] + done;
+        }
+        Kernels::deinterleave(source, dest.data(), m_channels, length);
+
+        done += length;
+        frame += length;
+    }
+
+    return total;
+}
+
+template <typename Sample>
+std::size_t InterleavedStore<Sample>::readInterleaved(std::size_t frame, const std::size_t count, float* out) const
+{
+    const std::size_t available{frames()};
+    if (frame >= available)
+    {
+        return 0;
+    }
+
+    const std::size_t total{std::min(count, available - frame)};
+    std::size_t done{0};
+    while (done < total)
+    {
+        const std::size_t offset{frame % s_chunkFrames};
+        const std::size_t length{std::min(total - done, s_chunkFrames - offset)};
+        const Sample* source{m_chunks.at(frame / s_chunkFrames) + offset * m_channels};
+
+        if constexpr (std::is_same_v<Sample, float>)
+        {
+            std::memcpy(out + done * m_channels, source, length * m_channels * sizeof(float));
+        }
+        else
+        {
+            Kernels::toFloat(source, out + done * m_channels, length * m_channels);
+        }
+
+        done += length;
+        frame += length;
+    }
+
+    return total;
+}
+
+template <typename Sample>
+std::size_t InterleavedStore<Sample>::readNative(std::size_t frame, const std::size_t count, void* out) const
+{
+    const std::size_t available{frames()};
+    if (frame >= available)
+    {
+        return 0;
+    }
+
+    const std::size_t total{std::min(count, available - frame)};
+    std::size_t done{0};
+    while (done < total)
+    {
+        const std::size_t offset{frame % s_chunkFrames};
+        const std::size_t length{std::min(total - done, s_chunkFrames - offset)};
+        const Sample* source{m_chunks.at(frame / s_chunkFrames) + offset * m_channels};
+        std::memcpy(static_cast<Sample*>(out) + done * m_channels, source, length * m_channels * sizeof(Sample));
+
+        done += length;
+        frame += length;
+    }
+
+    return total;
+}
+
+template <typename Sample>
+std::size_t InterleavedStore<Sample>::memoryUsage() const
+{
+    return m_storage.size() * s_chunkFrames * m_channels * sizeof(Sample);
+}
+
+template class InterleavedStore<float>;
+template class InterleavedStore<std::int16_t>;
+
+PackedStore::PackedStore(const int channels) : SampleStore{Format::Packed, channels}
+{
+    m_pending.resize(s_blockFrames * m_channels);
+}
+
+void* PackedStore::beginWrite(std::size_t& frames)
+{
+    // samples are staged until a block is full
+    frames = s_blockFrames - m_pendingFrames;
+    return m_pending.data() + m_pendingFrames * m_channels;
+}
+
+void PackedStore::endWrite(const std::size_t frames)
+{
+    m_pendingFrames += frames;
+    if (m_pendingFrames == s_blockFrames)
+    {
+        encodeBlock();
+    }
+}
+
+void PackedStore::finish()
+{
+    if (m_pendingFrames > 0)
+    {
+        encodeBlock();
+    }
+    SampleStore::finish();
+}
+
+void PackedStore::encodeBlock()
+{
+    const std::size_t blockFrames{m_pendingFrames};
+    const std::size_t maxSize{m_channels * encodedChannelSize(blockFrames, 17)};
+
+    if (m_arenaUsed + maxSize > s_arenaBytes)
+    {
+        m_arena.emplace_back(std::make_unique<std::uint8_t[]>(s_arenaBytes));
+        m_arenaUsed = 0;
+    }
+
+    std::uint8_t* const block{m_arena.back().get() + m_arenaUsed};
+    std::uint8_t* dest{block};
+
+    for (int c{0}; c < m_channels; ++c)
+    {
+        const std::int16_t first{m_pending[c]};
+
+        // smallest width that fits every delta of this channel
+        std::uint32_t maxDelta{0};
+        for (std::size_t i{1}; i < blockFrames; ++i)
+        {
+            maxDelta |= zigzag(m_pending[i * m_channels + c] - m_pending[(i - 1) * m_channels + c]);
+        }
+        unsigned bits{0};
+        while (bits < 17 && (maxDelta >> bits) != 0)
+        {
+            ++bits;
+        }
+
+        std::memcpy(dest, &first, sizeof(first));
+        dest[2] = static_cast<std::uint8_t>(bits);
+        dest += 3;
+
+        std::uint64_t accumulator{0};
+        unsigned filled{0};
+        for (std::size_t i{1}; i < blockFrames && bits > 0; ++i)
+        {
+            accumulator |= static_cast<std::uint64_t>(
+                               zigzag(m_pending[i * m_channels + c] - m_pending[(i - 1) * m_channels + c]))
+                           << filled;
+            filled += bits;
+            while (filled >= 8)
+            {
+                *dest++ = static_cast<std::uint8_t>(accumulator);
+                accumulator >>= 8;
+                filled -= 8;
+            }
+        }
+        if (filled > 0)
+        {
+            *dest++ = static_cast<std::uint8_t>(accumulator);
+        }
+    }
+
+    const std::size_t size{static_cast<std::size_t>(dest - block)};
+    if (!m_blocks.set(m_blockCount, block))
+    {
+        // out of block slots, drop the rest
+        m_pendingFrames = 0;
+        return;
+    }
+
+    m_arenaUsed += size;
+    ++m_blockCount;
+
+    publish(frames() + blockFrames);
+    m_pendingFrames = 0;
+}
+
+void PackedStore::decodeBlock(
+    const std::size_t block,
+    const std::size_t offset,
+    const std::size_t count,
+    float* const* out,
+    const std::size_t stride) const
+{
+    const std::size_t blockFrames{std::min(s_blockFrames, frames() - block * s_blockFrames)};
+    const std::uint8_t* source{m_blocks.at(block)};
+
+    for (int c{0}; c < m_channels; ++c)
+    {
+        std::int16_t first;
+        std::memcpy(&first, source, sizeof(first));
+        const unsigned bits{source[2]};
+        const std::uint8_t* packed{source + 3};
+        source += encodedChannelSize(blockFrames, bits);
+
+        const std::uint64_t mask{(std::uint64_t{1} << bits) - 1};
+        std::uint64_t accumulator{0};
+        unsigned filled{0};
+
+        // deltas have to be summed from the start of the block
+        std::int32_t value{first};
+        float* dest{out[c]};
+        for (std::size_t i{0}; i < offset + count; ++i)
+        {
+            if (i > 0 && bits > 0)
+            {
+                while (filled < bits)
+                {
+                    accumulator |= static_cast<std::uint64_t>(*packed++) << filled;
+                    filled += 8;
+                }
+                value += unzigzag(static_cast<std::uint32_t>(accumulator & mask));
+                accumulator >>= bits;
+                filled -= bits;
+            }
+
+            if (i >= offset)
+            {
+                dest[(i - offset) * stride] = Kernels::toFloat(static_cast<std::int16_t>(value));
+            }
+        }
+    }
+}
+
+std::size_t PackedStore::readPlanar(std::size_t frame, const std::size_t count, float* const* out) const
+{
+    const std::size_t available{frames()};
+    if (frame >= available)
+    {
+        return 0;
+    }
+
+    const std::size_t total{std::min(count, available - frame)};
+    std::array<float*, s_maxChannels> dest{};
+
+    std::size_t done{0};
+    while (done < total)
+    {
+        const std::size_t offset{frame % s_blockFrames};
+        const std::size_t length{std::min(total - done, s_blockFrames - offset)};
+        for (int c{0}; c < m_channels; ++c)
+        {
+            dest[c] = out[c] + done;
+        }
+        decodeBlock(frame / s_blockFrames, offset, length, dest.data(), 1);
+
+        done += length;
+        frame += length;
+    }
+
+    return total;
+}
+
+std::size_t PackedStore::readInterleaved(std::size_t frame, const std::size_t count, float* out) const
+{
+    const std::size_t available{frames()};
+    if (frame >= available)
+    {
+        return 0;
+    }
+
+    const std::size_t total{std::min(count, available - frame)};
+    std::array<float*, s_maxChannels> dest{};
+
+    std::size_t done{0};
+    while (done < total)
+    {
+        const std::size_t offset{frame % s_blockFrames};
+        const std::size_t length{std::min(total - done, s_blockFrames - offset)};
+        for (int c{0}; c < m_channels; ++c)
+        {
+            dest[c] = out + done * m_channels + c;
+        }
+        decodeBlock(frame / s_blockFrames, offset, length, dest.data(), m_channels);
+
+        done += length;
+        frame += length;
+    }
+
+    return total;
+}
+
+std::size_t PackedStore::memoryUsage() const { return m_arena.size() * s_arenaBytes; }
@@ -0,0 +1,181 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_SAMPLESTORE_H
+#define SPEEDSHIFTER_SAMPLESTORE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Two level table of pointers to fixed-size chunks.
+// Written by one thread, entries are only read by others once they have been published,
+// so nothing ever has to be moved or reallocated.
+template <typename T>
+class ChunkTable
+{
+public:
+    static constexpr std::size_t s_perPage{1 << 10};
+    static constexpr std::size_t s_maxPages{1 << 12};
+    static constexpr std::size_t s_capacity{s_perPage * s_maxPages};
+
+    [[nodiscard]] T* at(const std::size_t index) const { return (*m_pages[index / s_perPage])[index % s_perPage]; }
+
+    bool set(const std::size_t index, T* value)
+    {
+        if (index >= s_capacity)
+        {
+            return false;
+        }
+
+        std::unique_ptr<Page>& page{m_pages[index / s_perPage]};
+        if (!page)
+        {
+            page = std::make_unique<Page>();
+        }
+        (*page)[index % s_perPage] = value;
+        return true;
+    }
+
+private:
+    using Page = std::array<T*, s_perPage>;
+    std::array<std::unique_ptr<Page>, s_maxPages> m_pages{};
+};
+
+// Append-only PCM storage that can be read while it is still being written.
+// The decoder thread appends interleaved frames in the source's channel layout, the worker
+// thread expands whatever prefix has been published through frames() back to planar float.
+// Implementations decide how the samples are held in between.
+class SampleStore
+{
+public:
+    enum class Format
+    {
+        Float, // 32-bit float, interleaved
+        Int16, // 16-bit, interleaved
+        Packed // 16-bit, delta + bit packed blocks
+    };
+
+    static constexpr int s_maxChannels{8};
+
+    SampleStore(const Format format, const int channels) : m_format{format}, m_channels{channels} {}
+    virtual ~SampleStore() = default;
+
+    [[nodiscard]] static std::shared_ptr<SampleStore> create(Format format, int channels);
+
+    [[nodiscard]] int channels() const { return m_channels; }
+
+    // frames that are safe to read from any thread
+    [[nodiscard]] std::size_t frames() const { return m_frames.load(std::memory_order_acquire); }
+    // true once the decoder has appended the last frame
+    [[nodiscard]] bool finished() const { return m_finished.load(std::memory_order_acquire); }
+
+    // only called from the decoder thread
+    // (samples are written as float for Format::Float, as int16 for everything else)
+    [[nodiscard]] bool floatSamples() const { return m_format == Format::Float; }
+    // room for up to frames interleaved frames straight in the store's memory, nullptr once full
+    virtual void* beginWrite(std::size_t& frames) = 0;
+    // publishes frames written since beginWrite()
+    virtual void endWrite(std::size_t frames) = 0;
+    // copies frames in the store's sample type
+    void appendNative(const void* data, std::size_t frames);
+    // converts float frames to the store's sample type
+    void append(const float* data, std::size_t frames);
+    virtual void finish() { m_finished.store(true, std::memory_order_release); }
+
+    // expands up to count frames starting at frame into out[0..outChannels), returns frames read
+    // (outChannels must be >= channels(), mono is copied to every output, missing channels are zeroed)
+    std::size_t read(std::size_t frame, std::size_t count, float* const* out, int outChannels) const;
+    // expands up to count frames starting at frame into interleaved float, returns frames read
+    virtual std::size_t readInterleaved(std::size_t frame, std::size_t count, float* out) const = 0;
+    // copies up to count frames starting at frame as interleaved float or int16 (see floatSamples()), returns
+    // frames read
+    virtual std::size_t readNative(std::size_t frame, std::size_t count, void* out) const;
+
+    // bytes held for samples
+    [[nodiscard]] virtual std::size_t memoryUsage() const = 0;
+
+protected:
+    virtual std::size_t readPlanar(std::size_t frame, std::size_t count, float* const* out) const = 0;
+
+    void publish(const std::size_t frames) { m_frames.store(frames, std::memory_order_release); }
+
+    const Format m_format;
+    const int m_channels;
+
+private:
+    std::atomic<std::size_t> m_frames{0};
+    std::atomic<bool> m_finished{false};
+};
+
+// Samples held interleaved in fixed-size chunks of float or int16
+template <typename Sample>
+class InterleavedStore final : public SampleStore
+{
+public:
+    static constexpr std::size_t s_chunkFrames{1 << 16};
+
+    explicit InterleavedStore(int channels);
+    // wraps frames that already live elsewhere (e.g. a memory mapped cache file),
+    // owner keeps that memory alive for as long as the store exists
+    InterleavedStore(int channels, const Sample* data, std::size_t frames, std::shared_ptr<const void> owner);
+
+    void* beginWrite(std::size_t& frames) override;
+    void endWrite(std::size_t frames) override;
+    std::size_t readInterleaved(std::size_t frame, std::size_t count, float* out) const override;
+    std::size_t readNative(std::size_t frame, std::size_t count, void* out) const override;
+    [[nodiscard]] std::size_t memoryUsage() const override;
+
+protected:
+    std::size_t readPlanar(std::size_t frame, std::size_t count, float* const* out) const override;
+
+private:
+    ChunkTable<const Sample> m_chunks{};
+    std::size_t m_capacity{0}; // frames allocated so far (decoder thread only)
+
+    // memory behind the chunk table
+    std::vector<std::unique_ptr<Sample[]>> m_storage{};
+    std::shared_ptr<const void> m_owner{};
+};
+
+// Samples quantised to 16 bit, then stored per block and channel as the first sample plus
+// zigzag coded deltas packed to the smallest bit width that fits the block (lossless for 16 bit)
+class PackedStore final : public SampleStore
+{
+public:
+    static constexpr std::size_t s_blockFrames{1024};
+
+    explicit PackedStore(int channels);
+
+    void* beginWrite(std::size_t& frames) override;
+    void endWrite(std::size_t frames) override;
+    void finish() override;
+    std::size_t readInterleaved(std::size_t frame, std::size_t count, float* out) const override;
+    [[nodiscard]] std::size_t memoryUsage() const override;
+
+protected:
+    std::size_t readPlanar(std::size_t frame, std::size_t count, float* const* out) const override;
+
+private:
+    static constexpr std::size_t s_arenaBytes{1 << 20};
+
+    void encodeBlock();
+    // decodes count frames from offset inside block into planar outputs (advanced by stride per frame)
+    void decodeBlock(std::size_t block, std::size_t offset, std::size_t count, float* const* out, std::size_t stride)
+        const;
+
+    ChunkTable<const std::uint8_t> m_blocks{};
+    std::size_t m_blockCount{0};
+
+    // encoded blocks live in large arena allocations
+    std::vector<std::unique_ptr<std::uint8_t[]>> m_arena{};
+    std::size_t m_arenaUsed{s_arenaBytes};
+
+    // interleaved 16-bit frames of the block being filled
+    std::vector<std::int16_t> m_pending{};
+    std::size_t m_pendingFrames{0};
+};
+
+#endif // SPEEDSHIFTER_SAMPLESTORE_H
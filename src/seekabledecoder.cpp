@@ -0,0 +1,338 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#include "seekabledecoder.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+#include <libswresample/swresample.h>
+#include <libavutil/opt.h>
+}
+
+namespace
+{
+    // lets FFmpeg abort blocking reads as soon as decoding is cancelled
+    int interruptCallback(void* data)
+    {
+        const std::atomic<bool>* running{static_cast<const std::atomic<bool>*>(data)};
+        return running->load() ? 0 : 1;
+    }
+
+    [[nodiscard]] std::int64_t toFrame(
+        const std::int64_t pts,
+        const std::int64_t startPts,
+        const AVRational timeBase,
+        const int sampleRate)
+    {
+        return std::max<std::int64_t>(av_rescale_q(pts - startPts, timeBase, AVRational{1, sampleRate}), 0);
+    }
+} // namespace
+
+SeekableDecoder::~SeekableDecoder()
+{
+    av_packet_free(&m_packet);
+    av_frame_free(&m_frame);
+    swr_free(&m_swrContext);
+    avcodec_free_context(&m_codecContext);
+    avformat_close_input(&m_formatContext);
+}
+
+std::unique_ptr<SeekableDecoder> SeekableDecoder::open(
+    const QString& filePath,
+    const int sampleRate,
+    const int maxChannels,
+    const std::atomic<bool>& running,
+    std::shared_ptr<const SeekIndex> index)
+{
+    std::unique_ptr<SeekableDecoder> decoder{new SeekableDecoder{}};
+
+    decoder->m_formatContext = avformat_alloc_context();
+    decoder->m_formatContext->interrupt_callback.callback = interruptCallback;
+    decoder->m_formatContext->interrupt_callback.opaque = const_cast<std::atomic<bool>*>(&running);
+
+    int ret{avformat_open_input(&decoder->m_formatContext, filePath.toStdString().c_str(), nullptr, nullptr)};
+    if (ret < 0)
+    {
+        if (running.load())
+        {
+            qWarning() << "ERROR decoding media: Failed to open file: `" << filePath << "`!";
+        }
+        return nullptr;
+    }
+
+    ret = avformat_find_stream_info(decoder->m_formatContext, nullptr);
+    if (ret < 0)
+    {
+        qWarning() << "ERROR decoding media: Failed to find stream info!";
+        return nullptr;
+    }
+
+    decoder->m_streamIndex = av_find_best_stream(decoder->m_formatContext, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    if (decoder->m_streamIndex < 0)
+    {
+        qWarning() << "ERROR decoding media: No audio stream found in `" << filePath << "`";
+        return nullptr;
+    }
+
+    const AVStream* stream{decoder->m_formatContext->streams[decoder->m_streamIndex]};
+    const AVCodec* avDecoder{avcodec_find_decoder(stream->codecpar->codec_id)};
+    if (!avDecoder)
+    {
+        qWarning() << "ERROR decoding media: no decoder found!";
+        return nullptr;
+    }
+
+    decoder->m_codecContext = avcodec_alloc_context3(avDecoder);
+    avcodec_parameters_to_context(decoder->m_codecContext, stream->codecpar);
+    // range and streamed decoders already run side by side, codec threads would only compete with them
+    decoder->m_codecContext->thread_count = 1;
+
+    ret = avcodec_open2(decoder->m_codecContext, avDecoder, nullptr);
+    if (ret < 0)
+    {
+        qWarning() << "ERROR decoding media: failed to open decoder!";
+        return nullptr;
+    }
+
+    const int inputRate{decoder->m_codecContext->sample_rate};
+    const int outputRate{sampleRate > 0 ? sampleRate : inputRate};
+    const int channels{decoder->m_codecContext->ch_layout.nb_channels};
+    decoder->m_channels = std::min(channels, maxChannels);
+
+    AVChannelLayout inChannelLayout{decoder->m_codecContext->ch_layout};
+    if (inChannelLayout.order == AV_CHANNEL_ORDER_UNSPEC || inChannelLayout.nb_channels == 0)
+    {
+        av_channel_layout_default(&inChannelLayout, channels);
+    }
+    else
+    {
+        av_channel_layout_copy(&inChannelLayout, &decoder->m_codecContext->ch_layout);
+    }
+
+    AVChannelLayout outChannelLayout;
+    av_channel_layout_default(&outChannelLayout, decoder->m_channels);
+
+    ret = swr_alloc_set_opts2(
+        &decoder->m_swrContext,
+        &outChannelLayout,
+        AV_SAMPLE_FMT_FLT,
+        outputRate,
+        &inChannelLayout,
+        decoder->m_codecContext->sample_fmt,
+        inputRate,
+        0,
+        nullptr);
+
+    av_channel_layout_uninit(&inChannelLayout);
+    av_channel_layout_uninit(&outChannelLayout);
+
+    if (ret < 0 || !decoder->m_swrContext || swr_init(decoder->m_swrContext) < 0)
+    {
+        qWarning() << "ERROR decoding media: Failed to set up the resampler!";
+        return nullptr;
+    }
+
+    decoder->m_packet = av_packet_alloc();
+    decoder->m_frame = av_frame_alloc();
+
+    if (index)
+    {
+        decoder->m_index = std::move(index);
+        return decoder;
+    }
+
+    // only the header is read, seeks look everything else up in the container's index
+    const std::shared_ptr<SeekIndex> header{std::make_shared<SeekIndex>()};
+    header->sampleRate = outputRate;
+    header->channels = decoder->m_channels;
+    header->startPts = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    if (stream->duration != AV_NOPTS_VALUE && stream->duration > 0)
+    {
+        header->frames = static_cast<std::size_t>(av_rescale_q(stream->duration, stream->time_base, {1, outputRate}));
+    }
+    else if (decoder->m_formatContext->duration != AV_NOPTS_VALUE && decoder->m_formatContext->duration > 0)
+    {
+        header->frames = static_cast<std::size_t>(
+            av_rescale_q(decoder->m_formatContext->duration, {1, AV_TIME_BASE}, {1, outputRate}));
+    }
+    decoder->m_index = header;
+    return decoder;
+}
+
+bool SeekableDecoder::seek(const std::size_t frame)
+{
+    std::size_t preRoll{static_cast<std::size_t>(SeekIndex::s_preRollSeconds * m_index->sampleRate)};
+    for (int attempt{0}; attempt < SeekIndex::s_seekAttempts; ++attempt)
+    {
+        const std::size_t target{frame > preRoll ? frame - preRoll : 0};
+        if (!seekTo(target, frame))
+        {
+            return false;
+        }
+
+        // the first frame tells where that really landed, which is all kept if it's not past frame
+        while (m_landed < 0 && decodePacket())
+        {
+        }
+        if (m_landed <= static_cast<std::int64_t>(frame) || target == 0)
+        {
+            return true;
+        }
+        preRoll *= 2;
+    }
+
+    // the container's idea of where things are is way off, this at least gets there
+    qWarning() << "Seeking to frame" << frame << "keeps overshooting, decoding from the start";
+    return seekTo(0, frame);
+}
+
+bool SeekableDecoder::seekTo(const std::size_t target, const std::size_t frame)
+{
+    // the demuxer uses the container's index if it has one, otherwise it estimates from the bitrate
+    const AVStream* stream{m_formatContext->streams[m_streamIndex]};
+    const std::int64_t offset{
+        av_rescale_q(static_cast<std::int64_t>(target), {1, m_index->sampleRate}, stream->time_base)};
+    int ret{av_seek_frame(m_formatContext, m_streamIndex, m_index->startPts + offset, AVSEEK_FLAG_BACKWARD)};
+    if (ret < 0 && target == 0)
+    {
+        ret = av_seek_frame(m_formatContext, m_streamIndex, 0, AVSEEK_FLAG_BYTE);
+    }
+    if (ret < 0)
+    {
+        qWarning() << "ERROR decoding media: Failed to seek to frame" << frame;
+        return false;
+    }
+
+    avcodec_flush_buffers(m_codecContext);
+    // drops whatever the resampler still holds from before
+    swr_init(m_swrContext);
+
+    m_position = frame;
+    m_seekFrame = target;
+    m_decoded = -1;
+    m_landed = -1;
+    m_flushed = false;
+    m_pending.clear();
+    m_pendingOffset = 0;
+    return true;
+}
+
+std::size_t SeekableDecoder::read(float* out, const std::size_t frames)
+{
+    std::size_t done{0};
+    while (done < frames)
+    {
+        const std::size_t pending{(m_pending.size() - m_pendingOffset) / m_channels};
+        if (pending == 0)
+        {
+            if (!decodePacket())
+            {
+                break;
+            }
+            continue;
+        }
+
+        const std::size_t count{std::min(frames - done, pending)};
+        std::memcpy(out + done * m_channels, m_pending.data() + m_pendingOffset, count * m_channels * sizeof(float));
+        m_pendingOffset += count * m_channels;
+        if (m_pendingOffset == m_pending.size())
+        {
+            // only ever refilled once it has all been read, so it never has to be moved
+            m_pending.clear();
+            m_pendingOffset = 0;
+        }
+
+        done += count;
+        m_position += count;
+    }
+    return done;
+}
+
+bool SeekableDecoder::decodePacket()
+{
+    while (av_read_frame(m_formatContext, m_packet) >= 0)
+    {
+        if (m_packet->stream_index != m_streamIndex)
+        {
+            av_packet_unref(m_packet);
+            continue;
+        }
+
+        const int ret{avcodec_send_packet(m_codecContext, m_packet)};
+        av_packet_unref(m_packet);
+        if (ret < 0 && ret != AVERROR(EAGAIN))
+        {
+            qWarning() << "Failed to decode frame!";
+            continue;
+        }
+
+        receiveFrames();
+        return true;
+    }
+
+    if (m_flushed)
+    {
+        return false;
+    }
+
+    // drain the decoder, then the resampler
+    m_flushed = true;
+    avcodec_send_packet(m_codecContext, nullptr);
+    receiveFrames();
+    while (convert(nullptr, 0) > 0)
+    {
+    }
+    return true;
+}
+
+void SeekableDecoder::receiveFrames()
+{
+    while (avcodec_receive_frame(m_codecContext, m_frame) >= 0)
+    {
+        if (m_decoded < 0)
+        {
+            // the first frame after a seek tells where the resampler's output starts
+            const AVStream* stream{m_formatContext->streams[m_streamIndex]};
+            const std::int64_t pts{m_frame->best_effort_timestamp};
+            m_decoded = pts != AV_NOPTS_VALUE
+                            ? toFrame(pts, m_index->startPts, stream->time_base, m_index->sampleRate)
+                            : static_cast<std::int64_t>(m_seekFrame);
+            m_landed = m_decoded;
+        }
+        convert(const_cast<const std::uint8_t**>(m_frame->extended_data), m_frame->nb_samples);
+    }
+}
+
+int SeekableDecoder::convert(const std::uint8_t** input, const int inputSamples)
+{
+    const int maxSamples{swr_get_out_samples(m_swrContext, inputSamples)};
+    if (maxSamples <= 0 || m_decoded < 0)
+    {
+        return 0;
+    }
+
+    m_converted.resize(std::max(m_converted.size(), static_cast<std::size_t>(maxSamples) * m_channels));
+    auto* out{reinterpret_cast<std::uint8_t*>(m_converted.data())};
+    const int samples{std::max(swr_convert(m_swrContext, &out, maxSamples, input, inputSamples), 0)};
+
+    // frames [m_decoded, m_decoded + samples) against what the next read() needs
+    const std::int64_t needed{
+        static_cast<std::int64_t>(m_position + (m_pending.size() - m_pendingOffset) / m_channels)};
+    if (m_decoded > needed)
+    {
+        // a gap in the timestamps (or priming the decoder dropped) is filled with silence to keep frames in place
+        m_pending.resize(m_pending.size() + static_cast<std::size_t>(m_decoded - needed) * m_channels, 0.0f);
+    }
+    const std::int64_t skip{std::clamp<std::int64_t>(needed - m_decoded, 0, samples)};
+    m_pending.insert(
+        m_pending.end(), m_converted.begin() + skip * m_channels, m_converted.begin() + samples * m_channels);
+
+    m_decoded += samples;
+    return samples;
+}
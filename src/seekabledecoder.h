@@ -0,0 +1,98 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_SEEKABLEDECODER_H
+#define SPEEDSHIFTER_SEEKABLEDECODER_H
+
+#include <QString>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVPacket;
+struct AVFrame;
+struct SwrContext;
+
+// Where output frames lie in a file, taken from its header alone so opening costs the same however long the file
+// is. Seeks go through the container's own index (or its estimate from the bitrate) with av_seek_frame, and the
+// timestamp of the first frame decoded after one tells where it really landed.
+// Shared by every SeekableDecoder of the file, it never changes.
+struct SeekIndex
+{
+    // decoding starts at least this far ahead of a seek target, covers the MP3 bit reservoir and the resampler
+    static constexpr double s_preRollSeconds{0.1};
+    // a seek that lands past its target goes back twice as far, this many times before starting over at the top
+    static constexpr int s_seekAttempts{6};
+
+    int sampleRate{0};        // output, after resampling
+    int channels{0};          // output, after downmixing
+    std::int64_t startPts{0}; // output frame 0
+    std::size_t frames{0};    // in the whole stream at sampleRate as far as the container knows, 0 if it doesn't
+};
+
+// FFmpeg decode of a file's best audio stream to interleaved float that can start at any output frame, as exactly as
+// the container's timestamps allow. Reads carry on without seeking for as long as they are contiguous.
+// Not thread-safe, every thread that decodes the same file opens its own.
+class SeekableDecoder
+{
+public:
+    ~SeekableDecoder();
+
+    // Opens filePath resampled to sampleRate and downmixed to at most maxChannels, reads its index from the header if
+    // none is given. Blocking reads stop as soon as running is cleared, running has to outlive the decoder.
+    [[nodiscard]] static std::unique_ptr<SeekableDecoder> open(
+        const QString& filePath,
+        int sampleRate,
+        int maxChannels,
+        const std::atomic<bool>& running,
+        std::shared_ptr<const SeekIndex> index = nullptr);
+
+    [[nodiscard]] const std::shared_ptr<const SeekIndex>& index() const { return m_index; }
+
+    // output frame the next read() starts at
+    [[nodiscard]] std::size_t position() const { return m_position; }
+    // makes the next read() start exactly at frame, returns false if the demuxer couldn't seek
+    bool seek(std::size_t frame);
+    // decodes up to frames interleaved frames into out, fewer only at the end of the stream
+    std::size_t read(float* out, std::size_t frames);
+
+private:
+    SeekableDecoder() = default;
+
+    // seeks the demuxer to target (at or before frame) and makes frame the next one read
+    bool seekTo(std::size_t target, std::size_t frame);
+    // decodes the next packet into m_pending, false once there is nothing left to decode
+    bool decodePacket();
+    void receiveFrames();
+    // resamples input (nullptr flushes the resampler) and appends what lies at or after the read position
+    int convert(const std::uint8_t** input, int inputSamples);
+
+    AVFormatContext* m_formatContext{nullptr};
+    AVCodecContext* m_codecContext{nullptr};
+    SwrContext* m_swrContext{nullptr};
+    AVPacket* m_packet{nullptr};
+    AVFrame* m_frame{nullptr};
+    int m_streamIndex{-1};
+    int m_channels{0};
+
+    std::shared_ptr<const SeekIndex> m_index{};
+
+    std::size_t m_position{0};
+    // what the last seek aimed for, used if packets come without timestamps
+    std::size_t m_seekFrame{0};
+    // output frame of the first sample decoded since the last seek, -1 until there is one
+    std::int64_t m_landed{-1};
+    // output frame of the next sample out of the resampler, -1 until the first frame after a seek
+    std::int64_t m_decoded{-1};
+    bool m_flushed{false};
+
+    std::vector<float> m_pending{}; // decoded, read up to m_pendingOffset (samples)
+    std::size_t m_pendingOffset{0};
+    std::vector<float> m_converted{};
+};
+
+#endif // SPEEDSHIFTER_SEEKABLEDECODER_H
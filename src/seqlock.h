@@ -0,0 +1,66 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_SEQLOCK_H
+#define SPEEDSHIFTER_SEQLOCK_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Snapshot of a small struct that one thread keeps overwriting and any number of threads read.
+// The writer never waits (real-time safe), readers retry if they caught it halfway through a write.
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock only holds trivially copyable types");
+
+public:
+    // may only be called from one thread
+    void store(const T& value)
+    {
+        std::array<std::uint32_t, s_words> words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+
+        // odd while writing
+        const std::uint32_t sequence{m_sequence.load(std::memory_order_relaxed)};
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (std::size_t i{0}; i < s_words; ++i)
+        {
+            m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    [[nodiscard]] T load() const
+    {
+        std::array<std::uint32_t, s_words> words{};
+        std::uint32_t sequence;
+        do
+        {
+            sequence = m_sequence.load(std::memory_order_acquire);
+            for (std::size_t i{0}; i < s_words; ++i)
+            {
+                words[i] = m_words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((sequence & 1) != 0 || sequence != m_sequence.load(std::memory_order_relaxed));
+
+        T value{};
+        std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr std::size_t s_words{(sizeof(T) + sizeof(std::uint32_t) - 1) / sizeof(std::uint32_t)};
+
+    std::atomic<std::uint32_t> m_sequence{0};
+    // the payload is atomic too, so a torn read is just a retry instead of a data race
+    std::array<std::atomic<std::uint32_t>, s_words> m_words{};
+};
+
+#endif // SPEEDSHIFTER_SEQLOCK_H
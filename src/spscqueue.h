@@ -0,0 +1,53 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_SPSCQUEUE_H
+#define SPEEDSHIFTER_SPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Wait-free single producer, single consumer queue with a fixed capacity.
+// push() may only be called from one thread and pop() from one (other) thread.
+template <typename T, std::size_t Capacity>
+class SPSCQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two");
+
+public:
+    // returns false if the queue is full
+    bool push(const T& value)
+    {
+        const std::size_t tail{m_tail.load(std::memory_order_relaxed)};
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+
+        m_items[tail & (Capacity - 1)] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // returns false if the queue is empty
+    bool pop(T& value)
+    {
+        const std::size_t head{m_head.load(std::memory_order_relaxed)};
+        if (head == m_tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        value = m_items[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> m_items{};
+    // separate cache lines so producer and consumer don't keep stealing each other's
+    alignas(64) std::atomic<std::size_t> m_head{0};
+    alignas(64) std::atomic<std::size_t> m_tail{0};
+};
+
+#endif // SPEEDSHIFTER_SPSCQUEUE_H
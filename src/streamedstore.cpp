@@ -0,0 +1,305 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#include "streamedstore.h"
+#include "kernels.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+StreamedStore::StreamedStore(QString filePath, std::shared_ptr<const SeekIndex> index) :
+    SampleStore{Format::Float, index->channels},
+    m_filePath{std::move(filePath)},
+    m_index{std::move(index)},
+    m_blockCount{(m_index->frames + s_blockFrames - 1) / s_blockFrames},
+    m_capacity{std::max<std::size_t>(
+        STREAM_CACHE_BYTES / (s_blockFrames * m_index->channels * sizeof(float)), s_readAhead + 2)}
+{
+    publish(m_index->frames);
+    finish();
+
+    m_decoder = SeekableDecoder::open(m_filePath, m_index->sampleRate, m_index->channels, m_running, m_index);
+    m_aheadThread = std::thread(&StreamedStore::readAhead, this);
+}
+
+StreamedStore::~StreamedStore()
+{
+    {
+        std::lock_guard lock{m_aheadMutex};
+        m_running.store(false);
+    }
+    m_aheadWake.notify_one();
+    if (m_aheadThread.joinable())
+    {
+        m_aheadThread.join();
+    }
+}
+
+std::shared_ptr<StreamedStore> StreamedStore::open(
+    const QString& filePath,
+    const int sampleRate,
+    const int maxChannels,
+    const std::atomic<bool>& running)
+{
+    // this one only reads the header and goes away with running's owner, the store opens its own decoders
+    const std::unique_ptr<SeekableDecoder> header{SeekableDecoder::open(filePath, sampleRate, maxChannels, running)};
+    if (!header)
+    {
+        return nullptr;
+    }
+    if (header->index()->frames == 0)
+    {
+        qWarning() << "Can't stream `" << filePath << "`, the container doesn't say how long it is";
+        return nullptr;
+    }
+    return std::make_shared<StreamedStore>(filePath, header->index());
+}
+
+void* StreamedStore::beginWrite(std::size_t& frames)
+{
+    frames = 0;
+    return nullptr;
+}
+
+std::size_t StreamedStore::readInterleaved(std::size_t frame, const std::size_t count, float* out) const
+{
+    const std::size_t available{frames()};
+    if (frame >= available)
+    {
+        return 0;
+    }
+
+    const std::size_t total{std::min(count, available - frame)};
+    std::size_t done{0};
+    while (done < total)
+    {
+        const std::size_t offset{frame % s_blockFrames};
+        const std::size_t length{std::min(total - done, s_blockFrames - offset)};
+        const std::shared_ptr<const Block> source{block(frame / s_blockFrames)};
+        const std::size_t decoded{source ? source->samples.size() / m_channels : 0};
+
+        // short blocks (a file ending early or a decode error) read as silence
+        const std::size_t copied{std::min(length, decoded > offset ? decoded - offset : 0)};
+        if (copied > 0)
+        {
+            std::memcpy(
+                out + done * m_channels,
+                source->samples.data() + offset * m_channels,
+                copied * m_channels * sizeof(float));
+        }
+        std::fill_n(out + (done + copied) * m_channels, (length - copied) * m_channels, 0.0f);
+
+        done += length;
+        frame += length;
+    }
+
+    readingAt((frame - 1) / s_blockFrames);
+    return total;
+}
+
+std::size_t StreamedStore::readPlanar(std::size_t frame, const std::size_t count, float* const* out) const
+{
+    const std::size_t available{frames()};
+    if (frame >= available)
+    {
+        return 0;
+    }
+
+    const std::size_t total{std::min(count, available - frame)};
+    std::size_t done{0};
+    while (done < total)
+    {
+        const std::size_t offset{frame % s_blockFrames};
+        const std::size_t length{std::min(total - done, s_blockFrames - offset)};
+        const std::shared_ptr<const Block> source{block(frame / s_blockFrames)};
+        const std::size_t decoded{source ? source->samples.size() / m_channels : 0};
+
+        const std::size_t copied{std::min(length, decoded > offset ? decoded - offset : 0)};
+        std::array<float*, s_maxChannels> dest{};
+        for (int c{0}; c < m_channels; ++c)
+        {
+            dest[c] = out[c] + done;
+            std::fill_n(dest[c] + copied, length - copied, 0.0f);
+        }
+        if (copied > 0)
+        {
+            Kernels::deinterleave(source->samples.data() + offset * m_channels, dest.data(), m_channels, copied);
+        }
+
+        done += length;
+        frame += length;
+    }
+
+    readingAt((frame - 1) / s_blockFrames);
+    return total;
+}
+
+std::size_t StreamedStore::memoryUsage() const
+{
+    std::lock_guard lock{m_cacheMutex};
+    std::size_t bytes{0};
+    for (const std::shared_ptr<const Block>& block : m_blocks)
+    {
+        bytes += block->samples.size() * sizeof(float);
+    }
+    return bytes;
+}
+
+std::shared_ptr<const StreamedStore::Block> StreamedStore::block(const std::size_t index) const
+{
+    {
+        std::unique_lock lock{m_cacheMutex};
+        while (true)
+        {
+            if (std::shared_ptr<const Block> block{cached(index, true)})
+            {
+                return block;
+            }
+            // read-ahead is on it already, its result is as good as ours
+            if (!decoding(index))
+            {
+                break;
+            }
+            m_decodedWake.wait(lock);
+        }
+        m_decoding.push_back(index);
+    }
+
+    std::shared_ptr<const Block> block{};
+    {
+        std::lock_guard lock{m_decoderMutex};
+        if (m_decoder)
+        {
+            block = decode(*m_decoder, index);
+        }
+    }
+    decoded(index, block);
+    return block;
+}
+
+std::shared_ptr<const StreamedStore::Block> StreamedStore::cached(const std::size_t index, const bool touch) const
+{
+    for (auto it{m_blocks.begin()}; it != m_blocks.end(); ++it)
+    {
+        if ((*it)->index == index)
+        {
+            if (touch)
+            {
+                m_blocks.splice(m_blocks.begin(), m_blocks, it);
+            }
+            return *it;
+        }
+    }
+    return nullptr;
+}
+
+bool StreamedStore::decoding(const std::size_t index) const
+{
+    return std::find(m_decoding.begin(), m_decoding.end(), index) != m_decoding.end();
+}
+
+std::shared_ptr<const StreamedStore::Block> StreamedStore::decode(
+    SeekableDecoder& decoder,
+    const std::size_t index) const
+{
+    const std::size_t start{index * s_blockFrames};
+    const std::size_t frames{std::min(s_blockFrames, this->frames() - start)};
+
+    // sequential blocks carry straight on
+    if (decoder.position() != start && !decoder.seek(start))
+    {
+        return nullptr;
+    }
+
+    const std::shared_ptr<Block> block{std::make_shared<Block>()};
+    block->index = index;
+    block->samples.resize(frames * m_channels);
+    const std::size_t read{decoder.read(block->samples.data(), frames)};
+    block->samples.resize(read * m_channels);
+    // a short read is the end of the stream, unless it was cut short by closing the store
+    block->complete = read == frames || m_running.load();
+    return block;
+}
+
+void StreamedStore::decoded(const std::size_t index, const std::shared_ptr<const Block>& block) const
+{
+    {
+        std::lock_guard lock{m_cacheMutex};
+        // anything else is tried again on the next read
+        if (block && block->complete)
+        {
+            m_blocks.push_front(block);
+            while (m_blocks.size() > m_capacity)
+            {
+                m_blocks.pop_back();
+            }
+        }
+        m_decoding.erase(std::find(m_decoding.begin(), m_decoding.end(), index));
+    }
+    m_decodedWake.notify_all();
+}
+
+void StreamedStore::readingAt(const std::size_t index) const
+{
+    if (m_lastBlock.exchange(index, std::memory_order_relaxed) == index)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard lock{m_aheadMutex};
+        m_aheadFrom = index + 1;
+        m_aheadPending = true;
+    }
+    m_aheadWake.notify_one();
+}
+
+void StreamedStore::readAhead()
+{
+    const std::unique_ptr<SeekableDecoder> decoder{
+        SeekableDecoder::open(m_filePath, m_index->sampleRate, m_index->channels, m_running, m_index)};
+    if (!decoder)
+    {
+        return;
+    }
+
+    while (true)
+    {
+        std::size_t from;
+        {
+            std::unique_lock lock{m_aheadMutex};
+            m_aheadWake.wait(lock, [this]() { return m_aheadPending || !m_running.load(); });
+            if (!m_running.load())
+            {
+                return;
+            }
+            from = m_aheadFrom;
+            m_aheadPending = false;
+        }
+
+        for (std::size_t index{from}; index < std::min(from + s_readAhead, m_blockCount); ++index)
+        {
+            // start over from wherever reading has moved on to
+            {
+                std::lock_guard lock{m_aheadMutex};
+                if (m_aheadPending || !m_running.load())
+                {
+                    break;
+                }
+            }
+
+            {
+                // only looks, the block isn't being read yet
+                std::lock_guard lock{m_cacheMutex};
+                if (cached(index, false) || decoding(index))
+                {
+                    continue;
+                }
+                m_decoding.push_back(index);
+            }
+            decoded(index, decode(*decoder, index));
+        }
+    }
+}
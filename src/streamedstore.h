@@ -0,0 +1,107 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_STREAMEDSTORE_H
+#define SPEEDSHIFTER_STREAMEDSTORE_H
+
+#include <QString>
+
+#include "samplestore.h"
+#include "seekabledecoder.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Max size of the decoded blocks a streamed file keeps around
+#define STREAM_CACHE_BYTES (32ll * 1024 * 1024)
+// Max size of a streamed file's waveform, long files get coarser peaks instead
+#define STREAM_PEAK_BYTES (4ll * 1024 * 1024)
+
+// Samples of a file that is never decoded as a whole, for recordings too long to hold in memory.
+// Fixed-size blocks are decoded on demand through a SeekIndex and kept in a least recently used cache, while a
+// background thread decodes the blocks after the last one read. The length comes from the container, so the store
+// starts out finished and nothing is ever appended to it (blocks past where the file really ends read as silence).
+class StreamedStore final : public SampleStore
+{
+public:
+    static constexpr std::size_t s_blockFrames{1 << 15};
+    // decoded ahead of the last block read
+    static constexpr std::size_t s_readAhead{8};
+
+    StreamedStore(QString filePath, std::shared_ptr<const SeekIndex> index);
+    ~StreamedStore() override;
+
+    // opens filePath from its header alone, null if it can't be decoded or the container doesn't know its length
+    [[nodiscard]] static std::shared_ptr<StreamedStore> open(
+        const QString& filePath,
+        int sampleRate,
+        int maxChannels,
+        const std::atomic<bool>& running);
+
+    // to decode the file front to back with the same layout
+    [[nodiscard]] const std::shared_ptr<const SeekIndex>& index() const { return m_index; }
+
+    // the store is never written to
+    void* beginWrite(std::size_t& frames) override;
+    void endWrite(std::size_t) override {}
+    std::size_t readInterleaved(std::size_t frame, std::size_t count, float* out) const override;
+    [[nodiscard]] std::size_t memoryUsage() const override;
+
+protected:
+    std::size_t readPlanar(std::size_t frame, std::size_t count, float* const* out) const override;
+
+private:
+    struct Block
+    {
+        std::size_t index{0};
+        std::vector<float> samples{}; // interleaved
+        // every frame of the block, or up to where the stream really ends, only those are cached
+        bool complete{false};
+    };
+
+    // Cached, decoded by read-ahead right now (waited for), or else decoded right now. Frames it covers always start
+    // at index * s_blockFrames, null or short only if decoding failed.
+    [[nodiscard]] std::shared_ptr<const Block> block(std::size_t index) const;
+    // with m_cacheMutex held: the cached block, moved to the front of the list only if touch is set
+    [[nodiscard]] std::shared_ptr<const Block> cached(std::size_t index, bool touch) const;
+    [[nodiscard]] bool decoding(std::size_t index) const;
+    // null if the decoder couldn't seek to it
+    [[nodiscard]] std::shared_ptr<const Block> decode(SeekableDecoder& decoder, std::size_t index) const;
+    // caches block if it is complete and wakes whoever waits for index, after a decode marked in m_decoding
+    void decoded(std::size_t index, const std::shared_ptr<const Block>& block) const;
+    // wakes the read-ahead thread if reading has moved on to another block
+    void readingAt(std::size_t index) const;
+    void readAhead();
+
+    const QString m_filePath;
+    const std::shared_ptr<const SeekIndex> m_index;
+    const std::size_t m_blockCount;
+    const std::size_t m_capacity; // blocks
+
+    // cleared to abort every decoder of the store
+    std::atomic<bool> m_running{true};
+
+    // for blocks nobody decoded ahead, any reader
+    mutable std::mutex m_decoderMutex{};
+    mutable std::unique_ptr<SeekableDecoder> m_decoder{};
+
+    mutable std::mutex m_cacheMutex{};
+    mutable std::list<std::shared_ptr<const Block>> m_blocks{}; // most recently used first
+    // blocks some thread is decoding, anyone else who needs one waits on m_decodedWake instead of decoding it twice
+    mutable std::vector<std::size_t> m_decoding{};
+    mutable std::condition_variable m_decodedWake{};
+
+    mutable std::mutex m_aheadMutex{};
+    mutable std::condition_variable m_aheadWake{};
+    mutable std::size_t m_aheadFrom{0};
+    mutable bool m_aheadPending{true};
+    mutable std::atomic<std::size_t> m_lastBlock{0};
+    std::thread m_aheadThread{};
+};
+
+#endif // SPEEDSHIFTER_STREAMEDSTORE_H
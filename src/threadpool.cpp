@@ -0,0 +1,124 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace
+{
+    // which pool (and which of its queues) the current thread works for
+    thread_local const ThreadPool* s_pool{nullptr};
+    thread_local std::size_t s_index{0};
+} // namespace
+
+ThreadPool::ThreadPool(const int threads)
+{
+    const int count{threads > 0 ? threads : std::max(static_cast<int>(std::thread::hardware_concurrency()), 1)};
+    for (int i{0}; i < count; ++i)
+    {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+    for (int i{0}; i < count; ++i)
+    {
+        m_threads.emplace_back(&ThreadPool::run, this, static_cast<std::size_t>(i));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    wait();
+    {
+        std::lock_guard lock{m_mutex};
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(Task task)
+{
+    std::size_t index;
+    {
+        std::lock_guard lock{m_mutex};
+        index = s_pool == this ? s_index : m_next++ % m_queues.size();
+        ++m_queued;
+        ++m_pending;
+    }
+
+    {
+        std::lock_guard lock{m_queues[index]->mutex};
+        m_queues[index]->tasks.push_back(std::move(task));
+    }
+    m_wake.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock lock{m_mutex};
+    m_idle.wait(lock, [this]() { return m_pending == 0; });
+}
+
+void ThreadPool::run(const std::size_t index)
+{
+    s_pool = this;
+    s_index = index;
+
+    while (true)
+    {
+        Task task;
+        if (pop(index, task))
+        {
+            {
+                std::lock_guard lock{m_mutex};
+                --m_queued;
+            }
+
+            task();
+
+            std::lock_guard lock{m_mutex};
+            if (--m_pending == 0)
+            {
+                m_idle.notify_all();
+            }
+            continue;
+        }
+
+        // a task may be counted but not pushed yet, that only costs another look
+        std::unique_lock lock{m_mutex};
+        m_wake.wait(lock, [this]() { return m_stop || m_queued > 0; });
+        if (m_stop && m_queued == 0)
+        {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::pop(const std::size_t index, Task& task)
+{
+    {
+        Queue& own{*m_queues[index]};
+        std::lock_guard lock{own.mutex};
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (std::size_t i{1}; i < m_queues.size(); ++i)
+    {
+        Queue& other{*m_queues[(index + i) % m_queues.size()]};
+        std::lock_guard lock{other.mutex};
+        if (!other.tasks.empty())
+        {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,59 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_THREADPOOL_H
+#define SPEEDSHIFTER_THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool: every worker has its own queue and takes work from the others' once it runs dry.
+// Tasks submitted from a worker go to that worker's own queue, so follow-up work stays on the same core.
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // 0 threads uses every core
+    explicit ThreadPool(int threads = 0);
+    // waits for everything submitted so far
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(Task task);
+    // blocks until every task has finished, including the ones submitted by tasks
+    void wait();
+
+    [[nodiscard]] int threads() const { return static_cast<int>(m_threads.size()); }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex{};
+        std::deque<Task> tasks{};
+    };
+
+    void run(std::size_t index);
+    // newest task of our own queue, or the oldest one of someone else's
+    bool pop(std::size_t index, Task& task);
+
+    std::vector<std::unique_ptr<Queue>> m_queues{};
+    std::vector<std::thread> m_threads{};
+
+    std::mutex m_mutex{};
+    std::condition_variable m_wake{};
+    std::condition_variable m_idle{};
+    std::size_t m_queued{0};  // submitted, not started yet
+    std::size_t m_pending{0}; // submitted, not finished yet
+    std::size_t m_next{0};    // queue for the next task from outside the pool
+    bool m_stop{false};
+};
+
+#endif // SPEEDSHIFTER_THREADPOOL_H
@@ -0,0 +1,119 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#include "timeline.h"
+
+bool Timeline::pushBlock(const Block& block)
+{
+    return m_blocks.push(block);
+}
+
+void Timeline::played(const std::uint64_t ringFrame, const std::uint32_t frames)
+{
+    const std::uint64_t end{ringFrame + frames};
+    // skip blocks that were discarded or have already been played
+    bool changed{false};
+    while (true)
+    {
+        if (!m_hasNext)
+        {
+            m_hasNext = m_blocks.pop(m_next);
+        }
+        if (!m_hasNext || m_next.output > ringFrame)
+        {
+            break;
+        }
+        m_current = m_next;
+        m_hasNext = false;
+        changed = true;
+    }
+
+    // the first frame always gets an entry after silence or a new block, otherwise the last one carries on
+    if (changed || m_historyCount == 0 || m_history[(m_historyHead + s_history - 1) % s_history].speed == 0.0f)
+    {
+        Block block{m_current};
+        block.source += static_cast<double>(ringFrame - m_current.output) * m_current.speed;
+        block.output = m_deviceFrames;
+        record(block);
+    }
+
+    // blocks starting somewhere within this stretch
+    while (true)
+    {
+        if (!m_hasNext)
+        {
+            m_hasNext = m_blocks.pop(m_next);
+        }
+        if (!m_hasNext || m_next.output >= end)
+        {
+            break;
+        }
+        m_current = m_next;
+        m_hasNext = false;
+
+        Block block{m_current};
+        block.output = m_deviceFrames + (m_current.output - ringFrame);
+        record(block);
+    }
+
+    m_deviceFrames += frames;
+}
+
+void Timeline::silent(const std::uint32_t frames)
+{
+    if (m_historyCount == 0 || m_history[(m_historyHead + s_history - 1) % s_history].speed != 0.0f)
+    {
+        Block block{heard(0)};
+        block.speed = 0.0f;
+        record(block);
+    }
+    m_deviceFrames += frames;
+}
+
+Timeline::Block Timeline::heard(const std::uint64_t latency) const
+{
+    if (m_historyCount == 0)
+    {
+        return {};
+    }
+
+    const std::uint64_t frame{m_deviceFrames > latency ? m_deviceFrames - latency : 0};
+
+    // newest entry that started at or before frame (or the oldest one we still have)
+    std::size_t index{(m_historyHead + s_history - 1) % s_history};
+    for (std::size_t i{1}; i < m_historyCount && m_history[index].output > frame; ++i)
+    {
+        index = (index + s_history - 1) % s_history;
+    }
+
+    Block block{m_history[index]};
+    if (frame > block.output)
+    {
+        block.source += static_cast<double>(frame - block.output) * block.speed;
+        block.output = frame;
+    }
+    return block;
+}
+
+void Timeline::clear()
+{
+    Block block;
+    while (m_blocks.pop(block))
+    {
+    }
+    m_current = {};
+    m_next = {};
+    m_hasNext = false;
+    m_historyCount = 0;
+    m_historyHead = 0;
+    m_deviceFrames = 0;
+}
+
+void Timeline::record(const Block& block)
+{
+    m_history[m_historyHead] = block;
+    m_historyHead = (m_historyHead + 1) % s_history;
+    if (m_historyCount < s_history)
+    {
+        ++m_historyCount;
+    }
+}
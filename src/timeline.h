@@ -0,0 +1,64 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_TIMELINE_H
+#define SPEEDSHIFTER_TIMELINE_H
+
+#include "spscqueue.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Maps what the device is playing back to the source frame it came from.
+// The worker describes every block it writes to the ring buffer, the device callback
+// replays those descriptions against the frames it actually hands to the device.
+// Everything but clear() is real-time safe.
+class Timeline
+{
+public:
+    struct Block
+    {
+        std::uint64_t output{0}; // first frame, counted in ring buffer (pushBlock()) or device (heard()) frames
+        double source{0.0};      // source frame of that first frame
+        float speed{0.0f};       // source frames per output frame, 0 holds the position
+        std::uint32_t seek{0};   // serial of the seek the block belongs to
+    };
+
+    // A ring buffer of the smallest loops (MAX_BUFFER_PERIODS periods of the largest size, a wrap every 25 ms at the
+    // lowest speed) holds fewer blocks than this, so it only fills up if the device has stopped reading.
+    static constexpr std::size_t s_queueBlocks{256};
+
+    // worker: a block starting at ring buffer frame block.output is about to be written, false if there was no room
+    // for it (the position then carries on from the block before)
+    bool pushBlock(const Block& block);
+
+    // device callback: frames frames starting at ring buffer frame ringFrame go out next
+    void played(std::uint64_t ringFrame, std::uint32_t frames);
+    // device callback: frames frames of silence go out next (underrun)
+    void silent(std::uint32_t frames);
+    // device callback: the block heard right now, latency frames after everything handed out so far
+    // (source and output are moved to that exact frame)
+    [[nodiscard]] Block heard(std::uint64_t latency) const;
+
+    // only while neither thread uses it
+    void clear();
+
+private:
+    void record(const Block& block);
+
+    SPSCQueue<Block, s_queueBlocks> m_blocks{};
+
+    // callback side: the ring buffer block being played and the next one if already popped
+    Block m_current{};
+    Block m_next{};
+    bool m_hasNext{false};
+
+    // what went out in device frames, enough to look back past the device's own buffer
+    static constexpr std::size_t s_history{128};
+    std::array<Block, s_history> m_history{};
+    std::size_t m_historyCount{0};
+    std::size_t m_historyHead{0}; // next slot to write
+    std::uint64_t m_deviceFrames{0};
+};
+
+#endif // SPEEDSHIFTER_TIMELINE_H
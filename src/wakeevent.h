@@ -0,0 +1,34 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_WAKEEVENT_H
+#define SPEEDSHIFTER_WAKEEVENT_H
+
+#include <atomic>
+#include <cstdint>
+
+// Auto-reset event one thread blocks on until another one has something for it (a futex on Linux).
+// Signals don't queue up: any number of signal() calls before the next wait() wake it once.
+class WakeEvent
+{
+public:
+    // real-time safe: one atomic exchange, plus a wake-up call only if nothing was pending yet
+    void signal()
+    {
+        if (m_signalled.exchange(1, std::memory_order_acq_rel) == 0)
+        {
+            m_signalled.notify_one();
+        }
+    }
+
+    // returns straight away if signal() was called since the last wait()
+    void wait()
+    {
+        m_signalled.wait(0, std::memory_order_acquire);
+        m_signalled.exchange(0, std::memory_order_acq_rel);
+    }
+
+private:
+    std::atomic<std::uint32_t> m_signalled{0};
+};
+
+#endif // SPEEDSHIFTER_WAKEEVENT_H
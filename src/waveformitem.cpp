@@ -0,0 +1,285 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#include "waveformitem.h"
+
+#include <QMatrix4x4>
+#include <QSGClipNode>
+#include <QSGFlatColorMaterial>
+#include <QSGGeometryNode>
+#include <QSGTransformNode>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace
+{
+    // screen widths of bars kept in the mesh either side of the visible ones
+    constexpr double s_meshMargin{1.0};
+    constexpr float s_minBarHeight{4.0f};
+    constexpr float s_barScale{0.8f};
+
+    QSGGeometryNode* createGeometryNode(QSGGeometry::DrawingMode mode)
+    {
+        QSGGeometry* geometry{new QSGGeometry{QSGGeometry::defaultAttributes_Point2D(), 0}};
+        geometry->setDrawingMode(mode);
+
+        QSGGeometryNode* node{new QSGGeometryNode{}};
+        node->setGeometry(geometry);
+        node->setFlag(QSGNode::OwnsGeometry);
+        node->setMaterial(new QSGFlatColorMaterial{});
+        node->setFlag(QSGNode::OwnsMaterial);
+        return node;
+    }
+
+    void setNodeColor(QSGGeometryNode* node, const QColor& color)
+    {
+        QSGFlatColorMaterial* material{static_cast<QSGFlatColorMaterial*>(node->material())};
+        if (material->color() != color)
+        {
+            material->setColor(color);
+            node->markDirty(QSGNode::DirtyMaterial);
+        }
+    }
+
+    // the same bar mesh twice, clipped to either side of the playhead so only the clip colours it:
+    // root -> clip -> transform (scroll) -> bars, plus the playhead line on top
+    class WaveformNode : public QSGNode
+    {
+    public:
+        struct Layer
+        {
+            QSGClipNode* clip;
+            QSGTransformNode* transform;
+            QSGGeometryNode* bars;
+        };
+
+        WaveformNode()
+        {
+            for (Layer& layer : layers)
+            {
+                layer.clip = new QSGClipNode{};
+                layer.clip->setIsRectangular(true);
+                layer.clip->setGeometry(new QSGGeometry{QSGGeometry::defaultAttributes_Point2D(), 4});
+                layer.clip->setFlag(QSGNode::OwnsGeometry);
+
+                layer.transform = new QSGTransformNode{};
+                layer.bars = createGeometryNode(QSGGeometry::DrawTriangles);
+
+                layer.transform->appendChildNode(layer.bars);
+                layer.clip->appendChildNode(layer.transform);
+                appendChildNode(layer.clip);
+            }
+
+            playhead = createGeometryNode(QSGGeometry::DrawTriangleStrip);
+            playhead->geometry()->allocate(4);
+            appendChildNode(playhead);
+        }
+
+        std::array<Layer, 2> layers{}; // played, remaining
+        QSGGeometryNode* playhead{nullptr};
+    };
+
+    void setClipRect(QSGClipNode* clip, const QRectF& rect)
+    {
+        clip->setClipRect(rect);
+        QSGGeometry::updateRectGeometry(clip->geometry(), rect);
+        clip->markDirty(QSGNode::DirtyGeometry);
+    }
+} // namespace
+
+WaveformItem::WaveformItem(QQuickItem* parent) : QQuickItem{parent} { setFlag(ItemHasContents); }
+
+void WaveformItem::setPlayer(Player* player)
+{
+    if (m_player == player)
+    {
+        return;
+    }
+
+    if (m_player)
+    {
+        disconnect(m_player, nullptr, this, nullptr);
+    }
+
+    m_player = player;
+    if (m_player)
+    {
+        connect(m_player, &Player::waveformChanged, this, &WaveformItem::handleWaveformChanged);
+    }
+
+    handleWaveformChanged();
+    Q_EMIT playerChanged();
+}
+
+void WaveformItem::setPosition(const float seconds)
+{
+    if (m_position != seconds)
+    {
+        m_position = seconds;
+        // only moves the mesh, see updatePaintNode()
+        update();
+        Q_EMIT positionChanged();
+    }
+}
+
+void WaveformItem::setPixelsPerSecond(const float pixels)
+{
+    if (m_pixelsPerSecond != pixels && pixels > 0.0f)
+    {
+        m_pixelsPerSecond = pixels;
+        m_meshDirty = true;
+        update();
+        Q_EMIT pixelsPerSecondChanged();
+    }
+}
+
+void WaveformItem::setBarWidth(const float width)
+{
+    if (m_barWidth != width && width > 0.0f)
+    {
+        m_barWidth = width;
+        m_meshDirty = true;
+        update();
+        Q_EMIT barWidthChanged();
+    }
+}
+
+void WaveformItem::setColor(const QColor& color)
+{
+    if (m_color != color)
+    {
+        m_color = color;
+        update();
+        Q_EMIT colorChanged();
+    }
+}
+
+void WaveformItem::setPlayedColor(const QColor& color)
+{
+    if (m_playedColor != color)
+    {
+        m_playedColor = color;
+        update();
+        Q_EMIT playedColorChanged();
+    }
+}
+
+void WaveformItem::handleWaveformChanged()
+{
+    m_meshDirty = true;
+    update();
+}
+
+void WaveformItem::geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry)
+{
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    if (newGeometry.size() != oldGeometry.size())
+    {
+        m_meshDirty = true;
+        update();
+    }
+}
+
+QSGNode* WaveformItem::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData*)
+{
+    WaveformNode* node{static_cast<WaveformNode*>(oldNode)};
+    if (!node)
+    {
+        node = new WaveformNode{};
+        m_meshDirty = true;
+    }
+
+    const float itemWidth{static_cast<float>(width())};
+    const float itemHeight{static_cast<float>(height())};
+    const float centre{itemWidth * 0.5f};
+
+    // everything in bars from here on, bar n covers [n, n + 1) * secondsPerBar
+    const double secondsPerBar{static_cast<double>(m_barWidth) / static_cast<double>(m_pixelsPerSecond)};
+    const double playhead{static_cast<double>(m_position) / secondsPerBar};
+    const double halfScreen{static_cast<double>(centre) / static_cast<double>(m_barWidth)};
+
+    const bool pastStart{m_firstBar > 0 && playhead - halfScreen < static_cast<double>(m_firstBar)};
+    const bool pastEnd{playhead + halfScreen > static_cast<double>(m_firstBar + m_barCount)};
+
+    if (m_meshDirty || pastStart || pastEnd)
+    {
+        const double margin{halfScreen * 2.0 * s_meshMargin};
+        m_firstBar = std::max<qint64>(static_cast<qint64>(std::floor(playhead - halfScreen - margin)), 0);
+        m_barCount = static_cast<qint64>(std::ceil((halfScreen + margin) * 2.0)) + 1;
+
+        // the pyramid picks the level that matches one bar
+        QList<float> peaks{};
+        int channels{1};
+        qint64 bars{0};
+        if (const std::shared_ptr<PeakPyramid> pyramid{m_player ? m_player->getPeakPyramid() : nullptr})
+        {
+            const double framesPerBar{secondsPerBar * static_cast<double>(m_player->getSampleRate())};
+            const qint64 decodedBars{
+                static_cast<qint64>(std::ceil(static_cast<double>(pyramid->frames()) / framesPerBar))};
+            bars = std::clamp<qint64>(decodedBars - m_firstBar, 0, m_barCount);
+            channels = pyramid->channels();
+            peaks = pyramid->range(
+                static_cast<std::size_t>(static_cast<double>(m_firstBar) * framesPerBar),
+                static_cast<std::size_t>(static_cast<double>(m_firstBar + bars) * framesPerBar),
+                static_cast<int>(bars));
+        }
+
+        QSGGeometry* played{node->layers[0].bars->geometry()};
+        QSGGeometry* remaining{node->layers[1].bars->geometry()};
+        played->allocate(static_cast<int>(bars * 6));
+        remaining->allocate(static_cast<int>(bars * 6));
+
+        QSGGeometry::Point2D* vertices{played->vertexDataAsPoint2D()};
+        const qsizetype stride{channels * 2};
+        for (qint64 i{0}; i < bars; ++i)
+        {
+            // loudest channel, mirrored around the centre line
+            float peak{0.0f};
+            for (qsizetype j{0}; j < stride; ++j)
+            {
+                peak = std::max(peak, std::abs(peaks[i * stride + j]));
+            }
+
+            const float barHeight{std::min(std::max(s_minBarHeight, peak * itemHeight * s_barScale), itemHeight)};
+            const float x0{static_cast<float>(i) * m_barWidth};
+            const float x1{x0 + m_barWidth};
+            const float y0{(itemHeight - barHeight) * 0.5f};
+            const float y1{y0 + barHeight};
+
+            QSGGeometry::Point2D* bar{vertices + i * 6};
+            bar[0].set(x0, y0);
+            bar[1].set(x1, y0);
+            bar[2].set(x0, y1);
+            bar[3].set(x1, y0);
+            bar[4].set(x1, y1);
+            bar[5].set(x0, y1);
+        }
+        std::copy(vertices, vertices + bars * 6, remaining->vertexDataAsPoint2D());
+
+        node->layers[0].bars->markDirty(QSGNode::DirtyGeometry);
+        node->layers[1].bars->markDirty(QSGNode::DirtyGeometry);
+
+        setClipRect(node->layers[0].clip, QRectF{0.0, 0.0, centre, itemHeight});
+        setClipRect(node->layers[1].clip, QRectF{centre, 0.0, itemWidth - centre, itemHeight});
+
+        QSGGeometry::updateRectGeometry(node->playhead->geometry(), QRectF{centre - 0.5f, 0.0, 1.0, itemHeight});
+        node->playhead->markDirty(QSGNode::DirtyGeometry);
+
+        m_meshDirty = false;
+    }
+
+    // scrolling is just a translation of the mesh
+    QMatrix4x4 matrix{};
+    matrix.translate(centre - static_cast<float>((playhead - static_cast<double>(m_firstBar)) * m_barWidth), 0.0f);
+    for (const WaveformNode::Layer& layer : node->layers)
+    {
+        layer.transform->setMatrix(matrix);
+    }
+
+    setNodeColor(node->layers[0].bars, m_playedColor);
+    setNodeColor(node->layers[1].bars, m_color);
+    setNodeColor(node->playhead, m_playedColor);
+
+    return node;
+}
@@ -0,0 +1,80 @@
+// Created by Jens Kromdijk 17/10/2026
+
+#ifndef SPEEDSHIFTER_WAVEFORMITEM_H
+#define SPEEDSHIFTER_WAVEFORMITEM_H
+
+#include <QColor>
+#include <QPointer>
+#include <QQuickItem>
+#include <qqml.h>
+
+#include "player.h"
+
+// Scrolling waveform of the player's current file, centred on the playhead.
+// Bars are drawn as one triangle mesh per colour, built from the peak pyramid for a few screen widths around the
+// playhead. Position updates only move that mesh, it is rebuilt when the playhead gets close to its edges, the zoom
+// or size changes, or the decoder adds more peaks.
+class WaveformItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(Player* player READ player WRITE setPlayer NOTIFY playerChanged)
+    Q_PROPERTY(float position READ position WRITE setPosition NOTIFY positionChanged)
+    Q_PROPERTY(float pixelsPerSecond READ pixelsPerSecond WRITE setPixelsPerSecond NOTIFY pixelsPerSecondChanged)
+    Q_PROPERTY(float barWidth READ barWidth WRITE setBarWidth NOTIFY barWidthChanged)
+    Q_PROPERTY(QColor color READ color WRITE setColor NOTIFY colorChanged)
+    Q_PROPERTY(QColor playedColor READ playedColor WRITE setPlayedColor NOTIFY playedColorChanged)
+
+    QML_NAMED_ELEMENT(Waveform)
+
+public:
+    explicit WaveformItem(QQuickItem* parent = nullptr);
+
+    [[nodiscard]] Player* player() const { return m_player; }
+    void setPlayer(Player* player);
+
+    // in seconds
+    [[nodiscard]] float position() const { return m_position; }
+    void setPosition(float seconds);
+
+    [[nodiscard]] float pixelsPerSecond() const { return m_pixelsPerSecond; }
+    void setPixelsPerSecond(float pixels);
+
+    [[nodiscard]] float barWidth() const { return m_barWidth; }
+    void setBarWidth(float width);
+
+    [[nodiscard]] QColor color() const { return m_color; }
+    void setColor(const QColor& color);
+
+    [[nodiscard]] QColor playedColor() const { return m_playedColor; }
+    void setPlayedColor(const QColor& color);
+
+signals:
+    void playerChanged();
+    void positionChanged();
+    void pixelsPerSecondChanged();
+    void barWidthChanged();
+    void colorChanged();
+    void playedColorChanged();
+
+protected:
+    QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) override;
+    void geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry) override;
+
+private slots:
+    void handleWaveformChanged();
+
+private:
+    QPointer<Player> m_player{};
+    float m_position{0.0f};
+    float m_pixelsPerSecond{200.0f};
+    float m_barWidth{4.0f};
+    QColor m_color{};
+    QColor m_playedColor{};
+
+    // mesh state, updatePaintNode() only runs while the GUI thread is blocked
+    bool m_meshDirty{true};
+    qint64 m_firstBar{0}; // first bar in the current mesh
+    qint64 m_barCount{0};
+};
+
+#endif // SPEEDSHIFTER_WAVEFORMITEM_H